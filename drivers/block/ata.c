@@ -745,8 +745,10 @@ void ata_set_timeout(struct ide *ide, int timeout, int reason)
 
 void ata_end_request(struct ide *ide)
 {
-	struct blk_request *br, *brh;
+	struct blk_request *br, *brh, *next;
+	struct device *d;
 	struct xfer_data *xd;
+	int errno;
 
 	if(!ide->irq_timeout) {
 		del_callout(&ide->creq);
@@ -762,26 +764,32 @@ void ata_end_request(struct ide *ide)
 			printk("WARNING: block request: flag is %d in block %d.\n", br->status, br->block);
 		}
 
-		xd = (struct xfer_data *)br->device->xfer_data;
-		br->errno = xd->rw_end_fn(ide, xd);
-		if(br->errno < 0 || xd->count == xd->sectors_to_io) {
-			ide->device->requests_queue = (void *)br->next;
+		d = br->device;
+		next = br->next;
+		xd = (struct xfer_data *)d->xfer_data;
+		errno = br->errno = xd->rw_end_fn(ide, xd);
+		if(errno < 0 || xd->count == xd->sectors_to_io) {
+			ide->device->requests_queue = (void *)next;
 			br->status = BR_COMPLETED;
+			/* 'br' can't be used after this point */
 			if(br->head_group) {
 				brh = br->head_group;
 				brh->left--;
+				if(errno < 0) {
+					brh->errno = errno;
+				}
 				if(!brh->left) {
-					wakeup(brh);
+					end_blk_group(brh);
 				}
 			} else {
 				wakeup(br);
 			}
-			if(br->errno < 0) {
+			if(errno < 0) {
 				return;
 			}
 		}
-		if(br->next) {
-			run_blk_request(br->device);
+		if(next) {
+			run_blk_request(d);
 		}
 	}
 }
@@ -17,6 +17,8 @@
 #include <fiwix/stdio.h>
 #include <fiwix/string.h>
 
+struct slab_cache *blk_request_cache;
+
 /* append the request into the queue */
 void add_blk_request(struct blk_request *br)
 {
@@ -42,7 +44,7 @@ int do_blk_request(struct device *d, void *fn, struct buffer *buf)
 	struct blk_request *br;
 	int errno;
 
-	if(!(br = (struct blk_request *)kmalloc(sizeof(struct blk_request)))) {
+	if(!(br = (struct blk_request *)slab_alloc(blk_request_cache))) {
 		printk("WARNING: %s(): no more free memory for block requests.\n", __FUNCTION__);
 		return -ENOMEM;
 	}
@@ -62,15 +64,29 @@ int do_blk_request(struct device *d, void *fn, struct buffer *buf)
 	}
 	errno = br->errno;
 	if(!br->head_group) {
-		kfree((unsigned int)br);
+		slab_free(blk_request_cache, br);
 	}
 	return errno;
 }
 
+/*
+ * Called once all the requests of a group have been completed. An
+ * asynchronous group (the ones with 'end_io') is freed by its 'end_io'
+ * function, which might run in interrupt context.
+ */
+void end_blk_group(struct blk_request *brh)
+{
+	if(brh->end_io) {
+		brh->end_io(brh);
+	} else {
+		wakeup(brh);
+	}
+}
+
 void run_blk_request(struct device *d)
 {
 	unsigned long int flags;
-	struct blk_request *br, *brh;
+	struct blk_request *br, *brh, *next;
 	int errno;
 
 	SAVE_FLAGS(flags); CLI();
@@ -90,19 +106,25 @@ void run_blk_request(struct device *d)
 			return;
 		}
 		br->errno = errno;
-		d->requests_queue = (void *)br->next;
+		next = br->next;
+		d->requests_queue = (void *)next;
 		br->status = BR_COMPLETED;
 		if(br->head_group) {
 			brh = br->head_group;
 			brh->left--;
 			brh->errno = errno;
 			if(!brh->left) {
-				wakeup(brh);
+				end_blk_group(brh);
 			}
 		} else {
 			wakeup(br);
 		}
-		br = br->next;
+		br = next;
 	}
 	RESTORE_FLAGS(flags);
 }
+
+void blk_queue_init(void)
+{
+	blk_request_cache = slab_cache_create("blk_request", sizeof(struct blk_request), NULL);
+}
@@ -12,6 +12,8 @@
 #include <fiwix/errno.h>
 #include <fiwix/string.h>
 
+static struct slab_cache *cblock_cache;
+
 /*
 static struct cblock *insert_cblock_in_head(struct clist *q)
 {
@@ -20,7 +22,7 @@ static struct cblock *insert_cblock_in_head(struct clist *q)
 	if(q->cb_num >= NR_CB_QUEUE) {
 		return NULL;
 	}
-	if(!(cb = (struct cblock *)kmalloc(sizeof(struct cblock)))) {
+	if(!(cb = (struct cblock *)slab_alloc(cblock_cache))) {
 		return NULL;
 	}
 
@@ -46,7 +48,7 @@ static struct cblock *insert_cblock_in_tail(struct clist *q)
 	if(q->cb_num >= NR_CB_QUEUE) {
 		return NULL;
 	}
-	if(!(cb = (struct cblock *)kmalloc(sizeof(struct cblock)))) {
+	if(!(cb = (struct cblock *)slab_alloc(cblock_cache))) {
 		return NULL;
 	}
 
@@ -82,7 +84,7 @@ static void delete_cblock_from_head(struct clist *q)
 
 	q->count -= tmp->end_off - tmp->start_off;
 	q->cb_num--;
-	kfree((unsigned int)tmp);
+	slab_free(cblock_cache, tmp);
 }
 
 static void delete_cblock_from_tail(struct clist *q)
@@ -103,7 +105,7 @@ static void delete_cblock_from_tail(struct clist *q)
 
 	q->count -= tmp->end_off - tmp->start_off;
 	q->cb_num--;
-	kfree((unsigned int)tmp);
+	slab_free(cblock_cache, tmp);
 }
 
 int charq_putchar(struct clist *q, unsigned char ch)
@@ -206,3 +208,8 @@ int charq_room(struct clist *q)
 {
 	return (NR_CB_QUEUE * CBSIZE) - q->count;
 }
+
+void charq_init(void)
+{
+	cblock_cache = slab_cache_create("cblock", sizeof(struct cblock), NULL);
+}
@@ -503,7 +503,7 @@ int tty_read(struct inode *i, struct fd *fd_table, char *buffer, __size_t count)
 
 	/* only the foreground process group is allowed to read from the tty */
 	if(current->ctty == tty && current->pgid != tty->pgid) {
-		if(current->sigaction[SIGTTIN - 1].sa_handler == SIG_IGN || current->sigblocked & (1 << (SIGTTIN - 1)) || is_orphaned_pgrp(current->pgid)) {
+		if(current->sighand->action[SIGTTIN - 1].sa_handler == SIG_IGN || current->sigblocked & (1 << (SIGTTIN - 1)) || is_orphaned_pgrp(current->pgid)) {
 			return -EIO;
 		}
 		kill_pgrp(current->pgid, SIGTTIN, KERNEL);
@@ -650,7 +650,7 @@ int tty_write(struct inode *i, struct fd *fd_table, const char *buffer, __size_t
 	/* only the foreground process group is allowed to write to the tty */
 	if(current->ctty == tty && current->pgid != tty->pgid) {
 		if(tty->termios.c_lflag & TOSTOP) {
-			if(current->sigaction[SIGTTIN - 1].sa_handler != SIG_IGN && !(current->sigblocked & (1 << (SIGTTIN - 1)))) {
+			if(current->sighand->action[SIGTTIN - 1].sa_handler != SIG_IGN && !(current->sigblocked & (1 << (SIGTTIN - 1)))) {
 				if(is_orphaned_pgrp(current->pgid)) {
 					return -EIO;
 				}
@@ -1025,4 +1025,5 @@ int tty_select(struct inode *i, int flag)
 void tty_init(void)
 {
 	memset_b(tty_table, 0, sizeof(tty_table));
+	charq_init();
 }
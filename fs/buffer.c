@@ -13,6 +13,8 @@
 #include <fiwix/devices.h>
 #include <fiwix/fs.h>
 #include <fiwix/mm.h>
+#include <fiwix/mman.h>
+#include <fiwix/timer.h>
 #include <fiwix/errno.h>
 #include <fiwix/stdio.h>
 #include <fiwix/string.h>
@@ -48,7 +50,9 @@ struct buffer *buffer_retained_head[4];	/* heads of retained list */
  */
 struct buffer **buffer_hash_table;
 
+static struct slab_cache *page_buffer_cache;
 static struct resource sync_resource = { 0, 0 };
+static struct callout_req flush_creq;
 
 static struct buffer *add_buffer_to_pool(void)
 {
@@ -419,6 +423,31 @@ static int sync_one_buffer(struct buffer *buf)
 	return 0;
 }
 
+/*
+ * Releases the buffer of a file block that lives in the page cache, once it
+ * has been flushed. A dirty buffer is flushed first, as the block might be
+ * about to get other contents.
+ */
+static void detach_page_buffer(struct buffer *buf)
+{
+	unsigned int flags;
+
+	if(buf->flags & BUFFER_DIRTY) {
+		sync_one_buffer(buf);
+	}
+
+	SAVE_FLAGS(flags); CLI();
+	if(buf->prev_dirty) {
+		remove_from_dirty_list(buf);
+	}
+	remove_from_hash(buf);
+	RESTORE_FLAGS(flags);
+
+	release_page(buf->page);
+	slab_free(page_buffer_cache, buf);
+	wakeup(&buffer_wait);
+}
+
 static struct buffer *search_buffer_hash(__dev_t dev, __blk_t block, int size)
 {
 	struct buffer *buf;
@@ -451,6 +480,11 @@ static struct buffer *getblk(__dev_t dev, __blk_t block, int size)
 				continue;
 			}
 			buf->flags |= BUFFER_LOCKED;
+			if(buf->flags & BUFFER_PAGE) {
+				RESTORE_FLAGS(flags);
+				detach_page_buffer(buf);
+				continue;
+			}
 			remove_from_free_list(buf);
 			RESTORE_FLAGS(flags);
 			return buf;
@@ -481,6 +515,35 @@ static struct buffer *getblk(__dev_t dev, __blk_t block, int size)
 	}
 }
 
+/*
+ * Returns a temporary buffer to read a file block straight into its page
+ * (br->data), so the file contents are kept only in the page cache. If the
+ * block is still in the buffer cache its contents might be newer than the
+ * ones on the disk, then they are copied into the page instead.
+ */
+static struct buffer *get_page_buffer(struct blk_request *br)
+{
+	struct buffer *buf, *cached;
+
+	if(!(buf = (struct buffer *)slab_alloc(page_buffer_cache))) {
+		return NULL;
+	}
+	memset_b(buf, 0, sizeof(struct buffer));
+	buf->dev = br->dev;
+	buf->block = br->block;
+	buf->size = br->size;
+	buf->data = br->data;
+	buf->flags = BUFFER_PAGE | BUFFER_LOCKED;
+
+	if((cached = search_buffer_hash(br->dev, br->block, br->size))) {
+		if(cached->flags & BUFFER_VALID && cached->data != buf->data) {
+			memcpy_b(buf->data, cached->data, br->size);
+			buf->flags |= BUFFER_VALID;
+		}
+	}
+	return buf;
+}
+
 /* read a group of blocks */
 int gbread(struct device *d, struct blk_request *brh)
 {
@@ -490,7 +553,12 @@ int gbread(struct device *d, struct blk_request *brh)
 	br = brh->next_group;
 	while(br) {
 		if(!(br->flags & BRF_NOBLOCK)) {
-			if((buf = getblk(br->dev, br->block, br->size))) {
+			if(brh->flags & BRF_PAGE) {
+				buf = get_page_buffer(br);
+			} else {
+				buf = getblk(br->dev, br->block, br->size);
+			}
+			if(buf) {
 				br->buffer = buf;
 				if(buf->flags & BUFFER_VALID) {
 					br = br->next_group;
@@ -521,6 +589,55 @@ int gbread(struct device *d, struct blk_request *brh)
 	return brh->errno;
 }
 
+/*
+ * Read a group of blocks without waiting for them. The function 'end_io'
+ * of the group head is called once all the requests have been completed.
+ */
+void gbread_async(struct device *d, struct blk_request *brh)
+{
+	unsigned int flags;
+	struct blk_request *br;
+	struct buffer *buf;
+
+	/* this extra count prevents completing the group while it's queued */
+	brh->left = 1;
+
+	br = brh->next_group;
+	while(br) {
+		if(!(br->flags & BRF_NOBLOCK)) {
+			if(brh->flags & BRF_PAGE) {
+				buf = get_page_buffer(br);
+			} else {
+				buf = getblk(br->dev, br->block, br->size);
+			}
+			if(!buf) {
+				br->errno = -EIO;
+				br->flags |= BRF_NOBLOCK;
+				br = br->next_group;
+				continue;
+			}
+			br->buffer = buf;
+			if(!(buf->flags & BUFFER_VALID)) {
+				SAVE_FLAGS(flags); CLI();
+				brh->left++;
+				RESTORE_FLAGS(flags);
+				add_blk_request(br);
+			}
+		}
+		br = br->next_group;
+	}
+
+	run_blk_request(d);
+
+	SAVE_FLAGS(flags); CLI();
+	if(!--brh->left) {
+		RESTORE_FLAGS(flags);
+		end_blk_group(brh);
+		return;
+	}
+	RESTORE_FLAGS(flags);
+}
+
 /* read a single block */
 struct buffer *bread(__dev_t dev, __blk_t block, int size)
 {
@@ -552,10 +669,79 @@ void bwrite(struct buffer *buf)
 	brelse(buf);
 }
 
+/*
+ * Marks as dirty a file block whose contents live in a page of the page
+ * cache. Its buffer points into the page, which is kept in memory until
+ * the block is flushed. Any other copy of the block in the buffer cache
+ * is older, so it's dropped.
+ */
+int bwrite_page(struct page *pg, char *data, __dev_t dev, __blk_t block, int size)
+{
+	unsigned int flags;
+	struct buffer *buf, *new;
+
+	/* allocate it first, since slab_alloc() might sleep */
+	if(!(new = (struct buffer *)slab_alloc(page_buffer_cache))) {
+		return -ENOMEM;
+	}
+
+	for(;;) {
+		SAVE_FLAGS(flags); CLI();
+		if(!(buf = search_buffer_hash(dev, block, size))) {
+			break;
+		}
+		if(buf->flags & BUFFER_LOCKED) {
+			sleep(&buffer_wait, PROC_UNINTERRUPTIBLE);
+			RESTORE_FLAGS(flags);
+			continue;
+		}
+		if(buf->flags & BUFFER_PAGE && buf->data == data) {
+			/* still waiting to be flushed */
+			RESTORE_FLAGS(flags);
+			slab_free(page_buffer_cache, new);
+			return 0;
+		}
+		buf->flags |= BUFFER_LOCKED;
+		if(buf->flags & BUFFER_PAGE) {
+			RESTORE_FLAGS(flags);
+			detach_page_buffer(buf);
+			continue;
+		}
+		remove_from_free_list(buf);
+		if(buf->prev_dirty) {
+			remove_from_dirty_list(buf);
+		}
+		remove_from_hash(buf);
+		buf->flags &= ~(BUFFER_VALID | BUFFER_DIRTY);
+		RESTORE_FLAGS(flags);
+		brelse(buf);
+	}
+
+	memset_b(new, 0, sizeof(struct buffer));
+	new->dev = dev;
+	new->block = block;
+	new->size = size;
+	new->data = data;
+	new->page = pg;
+	new->flags = BUFFER_PAGE | BUFFER_VALID | BUFFER_DIRTY;
+	pg->count++;
+	insert_to_hash(new);
+	insert_on_dirty_list(new);
+	RESTORE_FLAGS(flags);
+	return 0;
+}
+
 void brelse(struct buffer *buf)
 {
 	unsigned int flags;
 
+	/* a temporary buffer used to read a block into a page */
+	if(buf->flags & BUFFER_PAGE) {
+		slab_free(page_buffer_cache, buf);
+		wakeup(&buffer_wait);
+		return;
+	}
+
 	SAVE_FLAGS(flags); CLI();
 
 	if(buf->flags & BUFFER_DIRTY) {
@@ -592,6 +778,9 @@ void sync_buffers(__dev_t dev)
 			if(!dev || buf->dev == dev) {
 				if(sync_one_buffer(buf)) {
 					insert_on_dirty_list(buf);
+				} else if(buf->flags & BUFFER_PAGE) {
+					detach_page_buffer(buf);
+					continue;
 				}
 			} else {
 				if(!first) {
@@ -751,13 +940,27 @@ int reclaim_buffers(void)
 	return reclaimed;
 }
 
+static void wakeup_kbdflushd(unsigned int arg)
+{
+	wakeup(&kbdflushd);
+}
+
+/*
+ * Besides being awakened when there are too many dirty buffers, kbdflushd
+ * also runs periodically to move the pages modified through the shared
+ * file mappings into the buffer cache, and to flush them from there.
+ */
 int kbdflushd(void)
 {
 	struct buffer *buf, *first;
 	int flushed, size;
 
+	flush_creq.fn = wakeup_kbdflushd;
+	flush_creq.arg = 0;
 	for(;;) {
+		add_callout(&flush_creq, FLUSH_INTERVAL * HZ);
 		sleep(&kbdflushd, PROC_INTERRUPTIBLE);
+		writeback_shared_mappings();
 		flushed = 0;
 
 		lock_resource(&sync_resource);
@@ -790,8 +993,12 @@ int kbdflushd(void)
 					wakeup(&buffer_wait);
 					continue;
 				}
-				buf->flags &= ~BUFFER_LOCKED;
-				wakeup(&buffer_wait);
+				if(buf->flags & BUFFER_PAGE) {
+					detach_page_buffer(buf);
+				} else {
+					buf->flags &= ~BUFFER_LOCKED;
+					wakeup(&buffer_wait);
+				}
 				flushed++;
 
 				if(flushed == NR_BUF_RECLAIM) {
@@ -815,4 +1022,5 @@ void buffer_init(void)
 	memset_b(buffer_retained_head, 0, sizeof(buffer_retained_head));
 	kstat.max_dirty_buffers = (kstat.max_buffers_size * BUFFER_DIRTY_RATIO) / 100;
 	memset_b(buffer_hash_table, 0, buffer_hash_table_size);
+	page_buffer_cache = slab_cache_create("page_buffer", sizeof(struct buffer), NULL);
 }
@@ -71,7 +71,7 @@ static void elf_create_stack(struct binargs *barg, unsigned int *sp, unsigned in
 	for(n = 0; n < ARG_MAX; n++) {
 		if(barg->page[n]) {
 			addr = PAGE_OFFSET - ((ARG_MAX - n) * PAGE_SIZE);
-			memcpy_b((void *)addr, (void *)barg->page[n], PAGE_SIZE);
+			copy_page((void *)addr, (void *)barg->page[n]);
 		}
 	}
 
@@ -462,10 +462,26 @@ int elf_load(struct inode *i, struct binargs *barg, struct sigcontext *sc, char
 #endif /*__DEBUG__ */
 
 
+	/* closing the close-on-exec fds and resetting the handlers must not affect others */
+	if((errno = unshare_files()) || (errno = unshare_sighand())) {
+		if(ii) {
+			iput(ii);
+		}
+		return errno;
+	}
+
+	/* a vfork() child gives the address space back to its parent */
+	if((errno = leave_vm())) {
+		if(ii) {
+			iput(ii);
+		}
+		return errno;
+	}
+
 	/* point of no return */
 
 	release_binary();
-	current->rss = 0;
+	current->mm->rss = 0;
 
 	current->entry_address = elf32_h->e_entry;
 	if(interpreter) {
@@ -538,7 +554,7 @@ int elf_load(struct inode *i, struct binargs *barg, struct sigcontext *sc, char
 		send_sig(current, SIGSEGV);
 		return -ENOEXEC;
 	}
-	current->brk_lower = start;
+	current->mm->brk_lower = start;
 
 	/* setup the HEAP section */
 	start = elf32_ph->p_vaddr + elf32_ph->p_memsz;
@@ -549,7 +565,7 @@ int elf_load(struct inode *i, struct binargs *barg, struct sigcontext *sc, char
 		send_sig(current, SIGSEGV);
 		return -ENOEXEC;
 	}
-	current->brk = start;
+	current->mm->brk = start;
 
 	/* setup the STACK section */
 	sp = PAGE_OFFSET - 4;	/* formerly 0xBFFFFFFC */
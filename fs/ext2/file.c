@@ -65,7 +65,6 @@ int ext2_file_open(struct inode *i, struct fd *fd_table)
 {
 	fd_table->offset = 0;
 	if(fd_table->flags & O_TRUNC) {
-		i->i_size = 0;
 		ext2_truncate(i, 0);
 	}
 	return 0;
@@ -82,9 +81,6 @@ int ext2_file_write(struct inode *i, struct fd *fd_table, const char *buffer, __
 	__size_t total_written;
 	unsigned int boffset, bytes;
 	int blksize, retval;
-	struct buffer *buf;
-	struct device *d;
-	struct blk_request brh, *br, *tmp;
 #ifdef CONFIG_OFFSET64
 	__loff_t offset;
 #else
@@ -101,85 +97,20 @@ int ext2_file_write(struct inode *i, struct fd *fd_table, const char *buffer, __
 	}
 	offset = fd_table->offset;
 
-	if(count > blksize) {
-		if(!(d = get_device(BLK_DEV, i->dev))) {
-			printk("WARNING: %s(): device major %d not found!\n", __FUNCTION__, MAJOR(i->dev));
-			inode_unlock(i);
-			return -ENXIO;
+	/* the data goes to the page cache, which reads the pages in groups */
+	while(total_written < count) {
+		boffset = offset % blksize;
+		if((block = bmap(i, offset, FOR_WRITING)) < 0) {
+			retval = block;
+			break;
 		}
-		memset_b(&brh, 0, sizeof(struct blk_request));
-		tmp = NULL;
-		while(total_written < count) {
-			if(!(br = (struct blk_request *)kmalloc(sizeof(struct blk_request)))) {
-				printk("WARNING: %s(): no more free memory for block requests.\n", __FUNCTION__);
-				retval = -ENOMEM;
-				break;
-			}
-			if((block = bmap(i, offset, FOR_WRITING)) < 0) {
-				retval = block;
-				break;
-			}
-			memset_b(br, 0, sizeof(struct blk_request));
-			br->dev = i->dev;
-			br->block = block;
-			br->size = blksize;
-			br->device = d;
-			br->fn = d->fsop->read_block;
-			br->head_group = &brh;
-			if(!brh.next_group) {
-				brh.next_group = br;
-			} else {
-				tmp->next_group = br;
-			}
-			tmp = br;
-			boffset = offset % blksize;
-			bytes = blksize - boffset;
-			bytes = MIN(bytes, (count - total_written));
-			total_written += bytes;
-			offset += bytes;
-		}
-		if(!retval) {
-			retval = gbread(d, &brh);
-		}
-		br = brh.next_group;
-		offset = fd_table->offset;
-		total_written = 0;
-		while(br) {
-			if(!retval) {
-				boffset = offset % blksize;
-				bytes = blksize - boffset;
-				bytes = MIN(bytes, (count - total_written));
-				memcpy_b(br->buffer->data + boffset, buffer + total_written, bytes);
-				update_page_cache(i, offset, buffer + total_written, bytes);
-				bwrite(br->buffer);
-				total_written += bytes;
-				offset += bytes;
-			} else {
-				brelse(br->buffer);
-			}
-			tmp = br->next_group;
-			kfree((unsigned int)br);
-			br = tmp;
-		}
-	} else {
-		while(total_written < count) {
-			boffset = offset % blksize;
-			if((block = bmap(i, offset, FOR_WRITING)) < 0) {
-				retval = block;
-				break;
-			}
-			bytes = blksize - boffset;
-			bytes = MIN(bytes, (count - total_written));
-			if(!(buf = bread(i->dev, block, blksize))) {
-				retval = -EIO;
-				break;
-			}
-			memcpy_b(buf->data + boffset, buffer + total_written, bytes);
-			update_page_cache(i, offset, buffer + total_written, bytes);
-			bwrite(buf);
-			total_written += bytes;
-			offset += bytes;
+		bytes = blksize - boffset;
+		bytes = MIN(bytes, (count - total_written));
+		if((retval = write_page_block(i, offset, block, buffer + total_written, bytes)) < 0) {
+			break;
 		}
+		total_written += bytes;
+		offset += bytes;
 	}
 
 	if(!retval) {
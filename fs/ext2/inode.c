@@ -515,6 +515,7 @@ int ext2_truncate(struct inode *i, __off_t length)
 		}
 	}
 
+	truncate_inode_pages(i, length);
 	i->i_mtime = CURRENT_TIME;
 	i->i_ctime = CURRENT_TIME;
 	i->i_size = length;
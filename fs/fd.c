@@ -49,9 +49,9 @@ int get_new_user_fd(int fd)
 	int n;
 
 	for(n = fd; n < OPEN_MAX && n < current->rlim[RLIMIT_NOFILE].rlim_cur; n++) {
-		if(current->fd[n] == 0) {
-			current->fd[n] = -1;
-			current->fd_flags[n] = 0;
+		if(current->files->fd[n] == 0) {
+			current->files->fd[n] = -1;
+			current->files->fd_flags[n] = 0;
 			return n;
 		}
 	}
@@ -61,7 +61,7 @@ int get_new_user_fd(int fd)
 
 void release_user_fd(int ufd)
 {
-	current->fd[ufd] = 0;
+	current->files->fd[ufd] = 0;
 }
 
 void fd_init(void)
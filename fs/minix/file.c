@@ -65,7 +65,6 @@ int minix_file_open(struct inode *i, struct fd *fd_table)
 {
 	fd_table->offset = 0;
 	if(fd_table->flags & O_TRUNC) {
-		i->i_size = 0;
 		minix_truncate(i, 0);
 	}
 	return 0;
@@ -81,8 +80,7 @@ int minix_file_write(struct inode *i, struct fd *fd_table, const char *buffer, _
 	__blk_t block;
 	__size_t total_written;
 	unsigned int boffset, bytes;
-	int blksize;
-	struct buffer *buf;
+	int blksize, errno;
 
 	inode_lock(i);
 
@@ -101,13 +99,10 @@ int minix_file_write(struct inode *i, struct fd *fd_table, const char *buffer, _
 		}
 		bytes = blksize - boffset;
 		bytes = MIN(bytes, (count - total_written));
-		if(!(buf = bread(i->dev, block, blksize))) {
+		if((errno = write_page_block(i, fd_table->offset, block, buffer + total_written, bytes)) < 0) {
 			inode_unlock(i);
-			return -EIO;
+			return errno;
 		}
-		memcpy_b(buf->data + boffset, buffer + total_written, bytes);
-		update_page_cache(i, fd_table->offset, buffer + total_written, bytes);
-		bwrite(buf);
 		total_written += bytes;
 		fd_table->offset += bytes;
 	}
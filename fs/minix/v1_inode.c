@@ -431,6 +431,7 @@ int v1_minix_truncate(struct inode *i, __off_t length)
 		block = 0;
 	}
 
+	truncate_inode_pages(i, length);
 	i->i_mtime = CURRENT_TIME;
 	i->i_ctime = CURRENT_TIME;
 	i->i_size = length;
@@ -531,6 +531,7 @@ int v2_minix_truncate(struct inode *i, __off_t length)
 		}
 	}
 
+	truncate_inode_pages(i, length);
 	i->i_mtime = CURRENT_TIME;
 	i->i_ctime = CURRENT_TIME;
 	i->i_size = length;
@@ -17,6 +17,8 @@
 #include <fiwix/stdio.h>
 #include <fiwix/string.h>
 
+static struct slab_cache *names_cache;
+
 static int do_namei(char *path, struct inode *dir, struct inode **i_res, struct inode **d_res, int follow_links)
 {
 	char *name, *ptr_name;
@@ -35,7 +37,7 @@ static int do_namei(char *path, struct inode *dir, struct inode **i_res, struct
 		}
 
 		/* extracts the next component of the path */
-		if(!(name = (char *)kmalloc(NAME_MAX + 1))) {
+		if(!(name = (char *)slab_alloc(names_cache))) {
 			return -ENOMEM;
 		}
 		ptr_name = name;
@@ -69,7 +71,7 @@ static int do_namei(char *path, struct inode *dir, struct inode **i_res, struct
 			break;
 		}
 
-		kfree((unsigned int)name);
+		slab_free(names_cache, name);
 		if(*path == '/') {
 			if(!S_ISDIR(i->i_mode) && !S_ISLNK(i->i_mode)) {
 				iput(dir);
@@ -105,7 +107,7 @@ static int do_namei(char *path, struct inode *dir, struct inode **i_res, struct
 		*i_res = i;
 	}
 
-	kfree((unsigned int)name);
+	slab_free(names_cache, name);
 	if(d_res) {
 		if(*d_res) {
 			iput(*d_res);
@@ -144,12 +146,12 @@ int parse_namei(char *path, struct inode *base_dir, struct inode **i_res, struct
 	}
 
 	if(!(dir = base_dir)) {
-		dir = current->pwd;
+		dir = current->fs->pwd;
 	}
 
 	/* it is definitely an absolute path */
 	if(path[0] == '/') {
-		dir = current->root;
+		dir = current->fs->root;
 	}
 	dir->count++;
 	errno = do_namei(path, dir, i_res, d_res, follow_links);
@@ -169,3 +171,8 @@ int namei(char *path, struct inode **i_res, struct inode **d_res, int follow_lin
 	}
 	return parse_namei(path, NULL, i_res, d_res, follow_links);
 }
+
+void namei_init(void)
+{
+	names_cache = slab_cache_create("names", NAME_MAX + 1, NULL);
+}
@@ -69,6 +69,23 @@ int data_proc_buddyinfo(char *buffer, __pid_t pid)
 	size += sprintk(buffer + size, "\n\n");
 	size += sprintk(buffer + size, "Memory requested (used): %d KB (%d KB)\n", kstat.buddy_low_mem_requested / 1024, (kstat.buddy_low_num_pages * PAGE_SIZE / 1024));
 
+	size += sprintk(buffer + size, "\nOrders:");
+	for(n = 0; n <= BUDDY_HIGH_MAX_ORDER; n++) {
+		size += sprintk(buffer + size, "\t%d", n);
+	}
+	size += sprintk(buffer + size, "\n");
+	size += sprintk(buffer + size, "------------------------------------------------------------------------------------------\n");
+	size += sprintk(buffer + size, "Used:");
+	for(n = 0; n <= BUDDY_HIGH_MAX_ORDER; n++) {
+		size += sprintk(buffer + size, "\t%d", kstat.buddy_high_count[n]);
+	}
+	size += sprintk(buffer + size, "\nFree:");
+	for(n = 0; n <= BUDDY_HIGH_MAX_ORDER; n++) {
+		size += sprintk(buffer + size, "\t%d", kstat.buddy_high_free[n]);
+	}
+	size += sprintk(buffer + size, "\n\n");
+	size += sprintk(buffer + size, "Contiguous memory (used): %d KB\n", kstat.buddy_high_num_pages * PAGE_SIZE / 1024);
+
 	return size;
 }
 
@@ -255,14 +272,14 @@ int data_proc_meminfo(char *buffer, __pid_t pid)
 	size = 0;
 	size += sprintk(buffer + size, "        total:    used:    free:  shared: buffers:  cached:\n");
 	size += sprintk(buffer + size, "Mem:  %8u %8u %8u %8u %8u %8u\n", kstat.total_mem_pages << PAGE_SHIFT, (kstat.total_mem_pages << PAGE_SHIFT) - (kstat.free_pages << PAGE_SHIFT), kstat.free_pages << PAGE_SHIFT, kstat.shared * 1024, kstat.buffers_size * 1024, kstat.cached * 1024);
-	size += sprintk(buffer + size, "Swap: %8u %8u %8u\n", 0, 0, 0);
+	size += sprintk(buffer + size, "Swap: %8u %8u %8u\n", kstat.swap_pages << PAGE_SHIFT, (kstat.swap_pages - kstat.free_swap_pages) << PAGE_SHIFT, kstat.free_swap_pages << PAGE_SHIFT);
 	size += sprintk(buffer + size, "MemTotal: %9d kB\n", kstat.total_mem_pages << 2);
 	size += sprintk(buffer + size, "MemFree:  %9d kB\n", kstat.free_pages << 2);
 	size += sprintk(buffer + size, "MemShared:%9d kB\n", kstat.shared);
 	size += sprintk(buffer + size, "Buffers:  %9d kB\n", kstat.buffers_size);
 	size += sprintk(buffer + size, "Cached:   %9d kB\n", kstat.cached);
-	size += sprintk(buffer + size, "SwapTotal:%9d kB\n", 0);
-	size += sprintk(buffer + size, "SwapFree: %9d kB\n", 0);
+	size += sprintk(buffer + size, "SwapTotal:%9d kB\n", kstat.swap_pages << 2);
+	size += sprintk(buffer + size, "SwapFree: %9d kB\n", kstat.free_swap_pages << 2);
 	size += sprintk(buffer + size, "Dirty:    %9d kB\n", kstat.dirty_buffers);
 	return size;
 }
@@ -355,6 +372,22 @@ int data_proc_rtc(char *buffer, __pid_t pid)
 	return size;
 }
 
+int data_proc_slabinfo(char *buffer, __pid_t pid)
+{
+	struct slab_cache *sc;
+	int n, size;
+
+	size = sprintk(buffer, "name\t\tactive\ttotal\tobjsize\tperslab\tslabs\tallocs\tfrees\n");
+	for(n = 0; n < NR_SLAB_CACHES; n++) {
+		sc = &slab_cache_table[n];
+		if(!sc->name) {
+			continue;
+		}
+		size += sprintk(buffer + size, "%s\t%s%d\t%d\t%d\t%d\t%d\t%u\t%u\n", sc->name, strlen(sc->name) < 8 ? "\t" : "", sc->active_objs, sc->num_slabs * sc->objs_per_slab, sc->size, sc->objs_per_slab, sc->num_slabs, sc->allocs, sc->frees);
+	}
+	return size;
+}
+
 int data_proc_stat(char *buffer, __pid_t pid)
 {
 	int n, size;
@@ -366,7 +399,7 @@ int data_proc_stat(char *buffer, __pid_t pid)
 	size += sprintk(buffer + size, "cpu %d %d %d %d\n", kstat.cpu_user, kstat.cpu_nice, kstat.cpu_system, idle);
 	size += sprintk(buffer + size, "disk 0 0 0 0\n");
 	size += sprintk(buffer + size, "page 0 0\n");
-	size += sprintk(buffer + size, "swap 0 0\n");
+	size += sprintk(buffer + size, "swap %u %u\n", kstat.pswpin, kstat.pswpout);
 	size += sprintk(buffer + size, "intr %u", kstat.irqs);
 	for(n = 0; n < NR_IRQS; n++) {
 		irq = irq_table[n];
@@ -378,6 +411,9 @@ int data_proc_stat(char *buffer, __pid_t pid)
 	size += sprintk(buffer + size, "ctxt %u\n", kstat.ctxt);
 	size += sprintk(buffer + size, "btime %d\n", kstat.boot_time);
 	size += sprintk(buffer + size, "processes %d\n", kstat.processes);
+	size += sprintk(buffer + size, "timer_bh_cycles %u\n", kstat.timer_bh_cycles);
+	size += sprintk(buffer + size, "callouts %u\n", kstat.callouts);
+	size += sprintk(buffer + size, "idle_oneshots %u\n", kstat.idle_oneshots);
 	return size;
 }
 
@@ -397,6 +433,29 @@ int data_proc_fullversion(char *buffer, __pid_t pid)
 	return sprintk(buffer, "Fiwix version %s %s\n", UTS_RELEASE, UTS_VERSION);
 }
 
+int data_proc_vmstat(char *buffer, __pid_t pid)
+{
+	int size;
+
+	size = 0;
+	size += sprintk(buffer + size, "nr_free_pages %d\n", kstat.free_pages);
+	size += sprintk(buffer + size, "nr_active %d\n", kstat.active_pages);
+	size += sprintk(buffer + size, "nr_inactive %d\n", kstat.inactive_pages);
+	size += sprintk(buffer + size, "nr_zeroed_pages %d\n", kstat.zeroed_pages);
+	size += sprintk(buffer + size, "pgcache_hit %u\n", kstat.pgcache_hits);
+	size += sprintk(buffer + size, "pgcache_miss %u\n", kstat.pgcache_misses);
+	size += sprintk(buffer + size, "pgcache_evict %u\n", kstat.pgcache_evictions);
+	size += sprintk(buffer + size, "pgactivate %u\n", kstat.pgactivate);
+	size += sprintk(buffer + size, "pgdeactivate %u\n", kstat.pgdeactivate);
+	size += sprintk(buffer + size, "pgreadahead %u\n", kstat.pgreadahead);
+	size += sprintk(buffer + size, "pgfaultaround %u\n", kstat.pgfaultaround);
+	size += sprintk(buffer + size, "pgzero_pool %u\n", kstat.pgzero_pool);
+	size += sprintk(buffer + size, "pgzero_sync %u\n", kstat.pgzero_sync);
+	size += sprintk(buffer + size, "pswpin %u\n", kstat.pswpin);
+	size += sprintk(buffer + size, "pswpout %u\n", kstat.pswpout);
+	return size;
+}
+
 
 int data_proc_unix(char *buffer, __pid_t pid)
 {
@@ -507,7 +566,13 @@ int data_proc_pid_fd(char *buffer, __pid_t pid, __ino_t inode)
 	size = 0;
 	ufd = inode & 0xFFF;
 	if((p = get_proc_by_pid(pid))) {
-		i = fd_table[p->fd[ufd]].inode;
+
+		/* zombie processes don't have file descriptors */
+		if(!p->files) {
+			return -ENOENT;
+		}
+
+		i = fd_table[p->files->fd[ufd]].inode;
 		size = sprintk(buffer, "[%02d%02d]:%d", MAJOR(i->dev), MINOR(i->dev), i->inode);
 	}
 	return size;
@@ -526,11 +591,15 @@ int data_proc_pid_cmdline(char *buffer, __pid_t pid)
 		for(n = 0; n < p->argc && (p->argv + n); n++) {
 			argv = p->argv + n;
 			offset = (int)argv & ~PAGE_MASK;
-			addr = get_mapped_addr(p, (int)argv) & PAGE_MASK;
+			if(!(addr = get_mapped_addr(p, (int)argv) & PAGE_MASK)) {
+				break;
+			}
 			addr = P2V(addr);
 			argv = (char **)(addr + offset);
 			offset = (int)argv[0] & ~PAGE_MASK;
-			addr = get_mapped_addr(p, (int)argv[0]) & PAGE_MASK;
+			if(!(addr = get_mapped_addr(p, (int)argv[0]) & PAGE_MASK)) {
+				break;
+			}
 			addr = P2V(addr);
 			arg = (char *)(addr + offset);
 			if(size + strlen(arg) < (PAGE_SIZE - 1)) {
@@ -554,11 +623,11 @@ int data_proc_pid_cwd(char *buffer, __pid_t pid)
 	if((p = get_proc_by_pid(pid))) {
 
 		/* zombie processes don't have current working directory */
-		if(!p->pwd) {
+		if(!p->fs || !p->fs->pwd) {
 			return -ENOENT;
 		}
 
-		i = p->pwd;
+		i = p->fs->pwd;
 		size = sprintk(buffer, "[%02d%02d]:%d", MAJOR(i->rdev), MINOR(i->rdev), i->inode);
 	}
 	return size;
@@ -577,11 +646,15 @@ int data_proc_pid_environ(char *buffer, __pid_t pid)
 		for(n = 0; n < p->envc && (p->envp + n); n++) {
 			envp = p->envp + n;
 			offset = (int)envp & ~PAGE_MASK;
-			addr = get_mapped_addr(p, (int)envp) & PAGE_MASK;
+			if(!(addr = get_mapped_addr(p, (int)envp) & PAGE_MASK)) {
+				break;
+			}
 			addr = P2V(addr);
 			envp = (char **)(addr + offset);
 			offset = (int)envp[0] & ~PAGE_MASK;
-			addr = get_mapped_addr(p, (int)envp[0]) & PAGE_MASK;
+			if(!(addr = get_mapped_addr(p, (int)envp[0]) & PAGE_MASK)) {
+				break;
+			}
 			addr = P2V(addr);
 			env = (char *)(addr + offset);
 			if(size + strlen(env) < (PAGE_SIZE - 1)) {
@@ -610,11 +683,11 @@ int data_proc_pid_exe(char *buffer, __pid_t pid)
 		 * This assumes that the first entry in the vma_table
 		 * contains the program's inode.
 		 */
-		if(!p->vma_table || !p->vma_table->inode) {
+		if(!p->mm->vma_table || !p->mm->vma_table->inode) {
 			return -ENOENT;
 		}
 
-		i = p->vma_table->inode;
+		i = p->mm->vma_table->inode;
 		size = sprintk(buffer, "[%02d%02d]:%d", MAJOR(i->rdev), MINOR(i->rdev), i->inode);
 	}
 	return size;
@@ -632,7 +705,7 @@ int data_proc_pid_maps(char *buffer, __pid_t pid)
 
 	size = 0;
 	if((p = get_proc_by_pid(pid))) {
-		vma = p->vma_table;
+		vma = p->mm->vma_table;
 		while(vma) {
 			r = vma->prot & PROT_READ ? 'r' : '-';
 			w = vma->prot & PROT_WRITE ? 'w' : '-';
@@ -711,11 +784,11 @@ int data_proc_pid_root(char *buffer, __pid_t pid)
 	if((p = get_proc_by_pid(pid))) {
 
 		/* zombie processes don't have root directory */
-		if(!p->root) {
+		if(!p->fs || !p->fs->root) {
 			return -ENOENT;
 		}
 
-		i = p->root;
+		i = p->fs->root;
 		size = sprintk(buffer, "[%02d%02d]:%d", MAJOR(i->rdev), MINOR(i->rdev), i->inode);
 	}
 	return size;
@@ -736,7 +809,7 @@ int data_proc_pid_stat(char *buffer, __pid_t pid)
 	vma_start = vma_end = 0;
 
 	if((p = get_proc_by_pid(pid))) {
-		vma = p->vma_table;
+		vma = p->mm->vma_table;
 
 		/*
 		 * This assumes that the first entry in the vma_table
@@ -768,12 +841,15 @@ int data_proc_pid_stat(char *buffer, __pid_t pid)
 		}
 
 		sigignored = sigcaught = 0;
-		for(signum = 0, mask = 1; signum < NSIG; signum++, mask <<= 1) {
-			if(p->sigaction[signum].sa_handler == SIG_IGN) {
-				sigignored |= mask;
-			}
-			if(p->sigaction[signum].sa_handler == SIG_DFL) {
-				sigcaught |= mask;
+		/* zombie processes don't have signal handlers */
+		if(p->sighand) {
+			for(signum = 0, mask = 1; signum < NSIG; signum++, mask <<= 1) {
+				if(p->sighand->action[signum].sa_handler == SIG_IGN) {
+					sigignored |= mask;
+				}
+				if(p->sighand->action[signum].sa_handler == SIG_DFL) {
+					sigcaught |= mask;
+				}
 			}
 		}
 
@@ -796,13 +872,13 @@ int data_proc_pid_stat(char *buffer, __pid_t pid)
 			tv2ticks(&p->usage.ru_stime),
 			tv2ticks(&p->cusage.ru_utime),
 			tv2ticks(&p->cusage.ru_stime),
-			0,			/* counter */
-			0,			/* priority */
+			p->prio,		/* priority */
+			p->nice,		/* nice */
 			0,			/* timeout */
 			0,			/* itrealvalue */
 			p->start_time,
 			text + data + stack + mmap,
-			p->rss,
+			p->mm->rss,
 			0x7FFFFFFF,		/* rlim */
 			vma_start,		/* startcode */
 			vma_end,		/* endcode */
@@ -828,7 +904,7 @@ int data_proc_pid_statm(char *buffer, __pid_t pid)
 
 	size = text = data = stack = mmap = 0;
 	if((p = get_proc_by_pid(pid))) {
-		vma = p->vma_table;
+		vma = p->mm->vma_table;
 		while(vma) {
 			switch(vma->s_type) {
 				case P_TEXT:
@@ -849,7 +925,7 @@ int data_proc_pid_statm(char *buffer, __pid_t pid)
 		}
 
 		size = sprintk(buffer, "%d", (text + data + stack + mmap) / PAGE_SIZE);
-		size += sprintk(buffer + size, " %d", p->rss);
+		size += sprintk(buffer + size, " %d", p->mm->rss);
 		size += sprintk(buffer + size, " 0");	/* shared mappings */
 		size += sprintk(buffer + size, " %d", text / PAGE_SIZE);
 		size += sprintk(buffer + size, " 0");
@@ -870,7 +946,7 @@ int data_proc_pid_status(char *buffer, __pid_t pid)
 
 	size = text = data = stack = mmap = 0;
 	if((p = get_proc_by_pid(pid))) {
-		vma = p->vma_table;
+		vma = p->mm->vma_table;
 		while(vma) {
 			switch(vma->s_type) {
 				case P_TEXT:
@@ -898,7 +974,7 @@ int data_proc_pid_status(char *buffer, __pid_t pid)
 		size += sprintk(buffer + size, "Gid:\t%d\t%d\t%d\t-\n", p->gid, p->egid, p->sgid);
 		size += sprintk(buffer + size, "VmSize:\t%8d kB\n", (text + data + stack + mmap) / 1024);
 		size += sprintk(buffer + size, "VmLck:\t%8d kB\n", 0);
-		size += sprintk(buffer + size, "VmRSS:\t%8d kB\n", p->rss << 2);
+		size += sprintk(buffer + size, "VmRSS:\t%8d kB\n", p->mm->rss << 2);
 		size += sprintk(buffer + size, "VmData:\t%8d kB\n", data / 1024);
 		size += sprintk(buffer + size, "VmStk:\t%8d kB\n", stack / 1024);
 		size += sprintk(buffer + size, "VmExe:\t%8d kB\n", text / 1024);
@@ -906,12 +982,15 @@ int data_proc_pid_status(char *buffer, __pid_t pid)
 		size += sprintk(buffer + size, "SigPnd:\t%08x\n", p->sigpending);
 		size += sprintk(buffer + size, "SigBlk:\t%08x\n", p->sigblocked);
 		sigignored = sigcaught = 0;
-		for(signum = 0, mask = 1; signum < NSIG; signum++, mask <<= 1) {
-			if(p->sigaction[signum].sa_handler == SIG_IGN) {
-				sigignored |= mask;
-			}
-			if(p->sigaction[signum].sa_handler == SIG_DFL) {
-				sigcaught |= mask;
+		/* zombie processes don't have signal handlers */
+		if(p->sighand) {
+			for(signum = 0, mask = 1; signum < NSIG; signum++, mask <<= 1) {
+				if(p->sighand->action[signum].sa_handler == SIG_IGN) {
+					sigignored |= mask;
+				}
+				if(p->sighand->action[signum].sa_handler == SIG_DFL) {
+					sigcaught |= mask;
+				}
 			}
 		}
 		size += sprintk(buffer + size, "SigIgn:\t%08x\n", sigignored);
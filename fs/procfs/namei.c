@@ -56,7 +56,7 @@ int procfs_lookup(const char *name, struct inode *dir, struct inode **i_res)
 		}
 
 		ufd = atoi(name);
-		if(p->fd[ufd]) {
+		if(p->files && p->files->fd[ufd]) {
 			inode = (PROC_FD_INO + (pid << 12)) + ufd;
 			if(!(*i_res = iget(dir->sb, inode))) {
 				return -EACCES;
@@ -12,6 +12,7 @@
 #include <fiwix/filesystems.h>
 #include <fiwix/fs_proc.h>
 #include <fiwix/mm.h>
+#include <fiwix/mman.h>
 #include <fiwix/stat.h>
 #include <fiwix/stdio.h>
 #include <fiwix/string.h>
@@ -125,18 +126,21 @@ int procfs_followlink(struct inode *dir, struct inode *i, struct inode **i_res)
 
 	if((i->inode & 0xF0000000) == PROC_FD_INO) {
 		ufd = i->inode & 0xFFF;
-		*i_res = fd_table[p->fd[ufd]].inode;
-		fd_table[p->fd[ufd]].inode->count++;
+		if(!p->files) {
+			return -ENOENT;
+		}
+		*i_res = fd_table[p->files->fd[ufd]].inode;
+		fd_table[p->files->fd[ufd]].inode->count++;
 		return 0;
 	}
 
 	switch(i->inode & 0xF0000FFF) {
 		case PROC_PID_CWD:
-			if(!p->pwd) {
+			if(!p->fs || !p->fs->pwd) {
 				return -ENOENT;
 			}
-			*i_res = p->pwd;
-			p->pwd->count++;
+			*i_res = p->fs->pwd;
+			p->fs->pwd->count++;
 			iput(i);
 			break;
 		case PROC_PID_EXE:
@@ -144,19 +148,19 @@ int procfs_followlink(struct inode *dir, struct inode *i, struct inode **i_res)
 			 * This assumes that the first entry in the vma_table
 			 * contains the program's inode.
 			 */
-			if(!p->vma_table || !p->vma_table->inode) {
+			if(!p->mm->vma_table || !p->mm->vma_table->inode) {
 				return -ENOENT;
 			}
-			*i_res = p->vma_table->inode;
-			p->vma_table->inode->count++;
+			*i_res = p->mm->vma_table->inode;
+			p->mm->vma_table->inode->count++;
 			iput(i);
 			break;
 		case PROC_PID_ROOT:
-			if(!p->root) {
+			if(!p->fs || !p->fs->root) {
 				return -ENOENT;
 			}
-			*i_res = p->root;
-			p->root->count++;
+			*i_res = p->fs->root;
+			p->fs->root->count++;
 			iput(i);
 			break;
 		default:
@@ -45,9 +45,11 @@ struct procfs_dir_entry procfs_array[][PROC_ARRAY_ENTRIES + 1] = {
 	{ 16,    REG,  1, 0, 10, "partitions",   data_proc_partitions },
 	{ 17,    REG,  1, 0, 3,  "rtc",          data_proc_rtc },
 	{ 18,    LNK,  1, 0, 4,  "self",         data_proc_self },
-	{ 19,    REG,  1, 0, 4,  "stat",         data_proc_stat },
-	{ 20,    REG,  1, 0, 6,  "uptime",       data_proc_uptime },
-	{ 21,    REG,  1, 0, 7,  "version",      data_proc_fullversion },
+	{ 19,    REG,  1, 0, 8,  "slabinfo",     data_proc_slabinfo },
+	{ 20,    REG,  1, 0, 4,  "stat",         data_proc_stat },
+	{ 21,    REG,  1, 0, 6,  "uptime",       data_proc_uptime },
+	{ 22,    REG,  1, 0, 7,  "version",      data_proc_fullversion },
+	{ 23,    REG,  1, 0, 6,  "vmstat",       data_proc_vmstat },
 	{ 0, 0, 0, 0, 0, NULL, NULL }
    },
    {	/* [1] /PID/ */
@@ -249,10 +249,10 @@ int mount_root(void)
 	mp->sb.dir->count++;
 	mp->fs = fs;
 
-	current->root = mp->sb.root;
-	current->root->count++;
-	current->pwd = mp->sb.root;
-	current->pwd->count++;
+	current->fs->root = mp->sb.root;
+	current->fs->root->count++;
+	current->fs->pwd = mp->sb.root;
+	current->fs->pwd->count++;
 	iput(mp->sb.root);
 
 	printk("mounted root device (%s filesystem)", fs->name);
@@ -16,6 +16,7 @@
 #define BR_COMPLETED	2
 
 #define BRF_NOBLOCK	1
+#define BRF_PAGE	2	/* the group reads straight into a page */
 
 struct blk_request {
 	int status;
@@ -28,13 +29,19 @@ struct blk_request {
 	struct device *device;
 	int (*fn)(__dev_t, __blk_t, char *, int);
 	int left;
+	void (*end_io)(struct blk_request *);	/* asynchronous group completion */
+	void *data;
 	struct blk_request *next;
 	struct blk_request *next_group;
 	struct blk_request *head_group;
 };
 
+extern struct slab_cache *blk_request_cache;
+
 void add_blk_request(struct blk_request *);
 int do_blk_request(struct device *, void *, struct buffer *);
+void end_blk_group(struct blk_request *);
 void run_blk_request(struct device *);
+void blk_queue_init(void);
 
 #endif /* _FIWIX_BLKQUEUE_H */
@@ -16,6 +16,7 @@
 #define BUFFER_VALID	0x01
 #define BUFFER_LOCKED	0x02
 #define BUFFER_DIRTY	0x04
+#define BUFFER_PAGE	0x08	/* data lives in a page of the page cache */
 
 #define BLK_READ	1
 #define BLK_WRITE	2
@@ -26,6 +27,7 @@ struct buffer {
 	int size;			/* block size (in bytes) */
 	int flags;
 	char *data;			/* block contents */
+	struct page *page;		/* page holding a dirty file block */
 	struct buffer *prev;
 	struct buffer *next;
 	struct buffer *prev_hash;
@@ -45,8 +47,10 @@ extern struct buffer **buffer_hash_table;
 extern unsigned int buffer_hash_table_size;	/* size in bytes */
 
 int gbread(struct device *, struct blk_request *);
+void gbread_async(struct device *, struct blk_request *);
 struct buffer *bread(__dev_t, __blk_t, int);
 void bwrite(struct buffer *);
+int bwrite_page(struct page *, char *, __dev_t, __blk_t, int);
 void brelse(struct buffer *);
 void sync_buffers(__dev_t);
 void invalidate_buffers(__dev_t);
@@ -10,7 +10,6 @@
 
 /* kernel tuning options */
 #define NR_PROCS		64	/* max. number of processes */
-#define NR_CALLOUTS		NR_PROCS	/* max. active callouts */
 #define NR_MOUNT_POINTS		8	/* max. number of mounted filesystems */
 #define NR_OPENS		1024	/* max. number of opened files */
 #define NR_FLOCKS		(NR_PROCS * 5)	/* max. number of flocks */
@@ -24,6 +23,13 @@
 					   size of the buffer table */
 #define NR_BUF_RECLAIM		250	/* buffers reclaimed in a single shot */
 #define BUFFER_DIRTY_RATIO	5	/* % of dirty buffers in buffer cache */
+#define FLUSH_INTERVAL		5	/* secs between periodic flushes */
+#define NR_SWAP_AREAS		8	/* max. number of active swap areas */
+#define NR_SWAP_RECLAIM		32	/* pages swapped out in a single shot */
+#define READAHEAD_MIN		4	/* initial readahead window (in pages) */
+#define READAHEAD_MAX		32	/* max. readahead window (in pages) */
+#define FAULT_AROUND_PAGES	16	/* cached pages mapped on a fault */
+#define NR_ZEROED_PAGES		256	/* max. pages zero-filled while idle */
 #define INODE_PERCENTAGE	1	/* % of memory for the inode table and
 					   hash table */
 #define INODE_HASH_PERCENTAGE	10	/* % of hash buckets relative to the
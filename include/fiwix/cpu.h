@@ -43,6 +43,9 @@
 
 #define RESERVED_DESC	0x80000000	/* TLB descriptor reserved */
 
+#define CR4_PSE		0x00000010	/* Page Size Extensions */
+#define CR4_PGE		0x00000080	/* Page Global Enable */
+
 struct cpu {
 	char *vendor_id;
 	char family;
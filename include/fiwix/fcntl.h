@@ -60,6 +60,14 @@
 				   blocking */
 #define LOCK_UN		8	/* unlock */
 
+/* for posix_fadvise() */
+#define POSIX_FADV_NORMAL	0	/* no special treatment */
+#define POSIX_FADV_RANDOM	1	/* expect random page references */
+#define POSIX_FADV_SEQUENTIAL	2	/* expect sequential page references */
+#define POSIX_FADV_WILLNEED	3	/* will need these pages */
+#define POSIX_FADV_DONTNEED	4	/* don't need these pages */
+#define POSIX_FADV_NOREUSE	5	/* data will be accessed once */
+
 /* IEEE Std 1003.1, 2004 Edition */
 struct flock {
 	short int l_type;	/* type of lock: F_RDLCK, F_WRLCK, F_UNLCK */
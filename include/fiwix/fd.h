@@ -13,7 +13,7 @@
 
 #define CHECK_UFD(ufd)							\
 {									\
-	if((ufd) > (OPEN_MAX - 1) || current->fd[(ufd)] == 0) {		\
+	if((ufd) > (OPEN_MAX - 1) || current->files->fd[(ufd)] == 0) {	\
 		return -EBADF;						\
 	}								\
 }									\
@@ -27,6 +27,10 @@ struct fd {
 #else
 	__off_t offset;			/* r/w pointer position */
 #endif /* CONFIG_OFFSET64 */
+	__off_t ra_next;		/* next page expected by readahead */
+	__off_t ra_end;			/* end of the pages read ahead */
+	int ra_pages;			/* readahead window (in pages) */
+	char advice;			/* POSIX_FADV_NORMAL, ... */
 };
 
 #endif /* _FIWIX_FS_H */
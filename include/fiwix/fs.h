@@ -240,6 +240,7 @@ void inode_init(void);
 
 int parse_namei(char *, struct inode *, struct inode **, struct inode **, int);
 int namei(char *, struct inode **, struct inode **, int);
+void namei_init(void);
 
 void superblock_lock(struct superblock *);
 void superblock_unlock(struct superblock *);
@@ -19,7 +19,7 @@
 #define PROC_FD_INO		0x50000000	/* base for FD inodes */
 #define PROC_FD_LEV		2	/* array level for FDs */
 
-#define PROC_ARRAY_ENTRIES	22
+#define PROC_ARRAY_ENTRIES	24
 
 enum pid_dir_inodes {
 	PROC_PID_FD = PROC_PID_INO + 1001,
@@ -65,9 +65,11 @@ int data_proc_mounts(char *, __pid_t);
 int data_proc_partitions(char *, __pid_t);
 int data_proc_rtc(char *, __pid_t);
 int data_proc_self(char *, __pid_t);
+int data_proc_slabinfo(char *, __pid_t);
 int data_proc_stat(char *, __pid_t);
 int data_proc_uptime(char *, __pid_t);
 int data_proc_fullversion(char *, __pid_t);
+int data_proc_vmstat(char *, __pid_t);
 int data_proc_unix(char *, __pid_t);
 int data_proc_buffernr(char *, __pid_t);
 int data_proc_domainname(char *, __pid_t);
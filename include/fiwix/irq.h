@@ -19,6 +19,7 @@ struct interrupt {
 	struct interrupt *next;
 };
 extern struct interrupt *irq_table[NR_IRQS];
+extern int in_interrupt;
 
 
 #define BH_ACTIVE	0x01
@@ -13,6 +13,7 @@
 
 #define QEMU_DEBUG_PORT		0xE9	/* for Bochs-style debug console */
 #define BUDDY_MAX_LEVEL		7
+#define BUDDY_HIGH_MAX_ORDER	10
 
 #define PANIC(format, args...)						\
 {									\
@@ -48,6 +49,7 @@ extern char kparm_initrd[DEVNAME_MAX + 1];
 extern int kparm_syscondev;
 extern char kparm_bgaresolution[15];
 extern int kparm_ro;
+extern int kparm_faultaround;
 extern int kexec_proto;
 extern int kexec_size;
 extern char kexec_cmdline[NAME_MAX + 1];
@@ -86,6 +88,9 @@ struct kernel_stat {
 	int physical_reserved;		/* physical memory reserved (in KB) */
 	int total_mem_pages;		/* total memory (in pages) */
 	int free_pages;			/* pages on free list */
+	int active_pages;		/* free cached pages on active list */
+	int inactive_pages;		/* free cached pages on inactive list */
+	int zeroed_pages;		/* free pages already zero-filled */
 	int min_free_pages;		/* minimal free pages in system */
 	int max_inodes;			/* max. number of allocated inodes */
 	int nr_inodes;			/* current allocated inodes */
@@ -100,12 +105,33 @@ struct kernel_stat {
 	unsigned int random_seed;	/* next random seed */
 	int pages_reclaimed;		/* last pages reclaimed from buffer */
 	int nr_flocks;			/* current allocated file locks */
+	int swap_pages;			/* total swap space (in pages) */
+	int free_swap_pages;		/* free swap space (in pages) */
+	unsigned int pswpin;		/* pages swapped in since boot */
+	unsigned int pswpout;		/* pages swapped out since boot */
+	unsigned int pgcache_hits;	/* page cache lookups found */
+	unsigned int pgcache_misses;	/* page cache lookups not found */
+	unsigned int pgcache_evictions;	/* cached pages reused */
+	unsigned int pgactivate;	/* pages moved to the active list */
+	unsigned int pgdeactivate;	/* pages moved to the inactive list */
+	unsigned int pgreadahead;	/* pages read ahead */
+	unsigned int pgfaultaround;	/* pages mapped around a fault */
+	unsigned int pgzero_pool;	/* zeroed pages taken from the pool */
+	unsigned int pgzero_sync;	/* zeroed pages cleared on demand */
+	unsigned int timer_bh_cycles;	/* TSC cycles spent in irq_timer_bh */
+	unsigned int callouts;		/* callouts run since boot */
+	unsigned int idle_oneshots;	/* ticks stopped while idle */
 
 	/* buddy_low algorithm statistics */
 	int buddy_low_count[BUDDY_MAX_LEVEL + 1];
 	int buddy_low_num_pages;	/* number of pages used */
 	int buddy_low_mem_requested;	/* total memory requested (in bytes) */
 
+	/* buddy_high algorithm statistics */
+	int buddy_high_count[BUDDY_HIGH_MAX_ORDER + 1];
+	int buddy_high_free[BUDDY_HIGH_MAX_ORDER + 1];
+	int buddy_high_num_pages;	/* number of pages used */
+
 	int mount_points;		/* number of fs currently mounted */
 };
 extern struct kernel_stat kstat;
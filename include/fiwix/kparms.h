@@ -36,6 +36,10 @@ static struct kparms parm_table[] = {
 	     0x440, 0x441, 0x442, 0x443
 	   }
 	},
+	{ "faultaround=",
+	   { 0 },
+	   { 0 },
+	},
 	{ "initrd=",
 	   { 0 },
 	   { 0 },
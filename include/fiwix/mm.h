@@ -25,9 +25,17 @@
 #define PD_ENTRIES		(PAGE_SIZE / sizeof(unsigned int))
 
 #define PAGE_LOCKED		0x001
+#define PAGE_REFERENCED		0x002	/* cached page recently used */
+#define PAGE_ACTIVE		0x004	/* page is on the active list */
+#define PAGE_INACTIVE		0x008	/* page is on the inactive list */
 #define PAGE_BUDDYLOW		0x010	/* page belongs to buddy_low */
+#define PAGE_BUDDYHIGH		0x020	/* page belongs to buddy_high */
+#define PAGE_SLAB		0x040	/* page is a slab of an object cache */
+#define PAGE_IOERROR		0x080	/* error while reading the page */
 #define PAGE_RESERVED		0x100	/* kernel, BIOS address, ... */
 #define PAGE_COW		0x200	/* marked for Copy-On-Write */
+#define PAGE_ZEROED		0x400	/* free page already zero-filled */
+#define PAGE_MODIFIED		0x800	/* dirtied through a shared mapping */
 
 #define PFAULT_V		0x01	/* protection violation */
 #define PFAULT_W		0x02	/* during write */
@@ -44,6 +52,7 @@ struct page {
 	__off_t offset;		/* file offset */
 	__dev_t dev;		/* device where file resides */
 	char *data;		/* page contents */
+	int order;		/* block order (buddy_high only) */
 	struct page *prev_hash;
 	struct page *next_hash;
 	struct page *prev_free;
@@ -58,6 +67,7 @@ extern unsigned int page_table_size;		/* size in bytes */
 extern unsigned int page_hash_table_size;	/* size in bytes */
 
 extern unsigned int *kpage_dir;
+extern struct page *zero_page;
 
 
 /* buddy_low.c */
@@ -82,6 +92,44 @@ unsigned int bl_malloc(__size_t);
 void bl_free(unsigned int);
 void buddy_low_init(void);
 
+/* buddy_high.c */
+unsigned int bh_malloc(__size_t);
+void bh_free(unsigned int);
+int buddy_high_reclaim(void);
+void buddy_high_init(void);
+
+/* slab.c */
+#define NR_SLAB_CACHES		16
+#define SLAB_HDR_SIZE		((sizeof(struct slab) + 7) & ~7)
+
+struct slab {
+	struct slab_cache *cache;
+	int inuse;		/* number of objects in use */
+	void *free;		/* first free object */
+	struct slab *prev;
+	struct slab *next;
+};
+
+struct slab_cache {
+	const char *name;
+	int size;		/* object size (aligned) */
+	int objs_per_slab;
+	void (*ctor)(void *);	/* called on every allocation */
+	struct slab *partial;	/* slabs with some free objects */
+	struct slab *full;	/* slabs without free objects */
+	struct slab *empty;	/* a completely free slab */
+	int num_slabs;
+	int active_objs;
+	unsigned int allocs;
+	unsigned int frees;
+};
+
+extern struct slab_cache slab_cache_table[NR_SLAB_CACHES];
+
+struct slab_cache *slab_cache_create(const char *, int, void (*)(void *));
+void *slab_alloc(struct slab_cache *);
+void slab_free(struct slab_cache *, void *);
+
 /* alloc.c */
 unsigned int kmalloc(__size_t);
 void kfree(unsigned int);
@@ -90,13 +138,21 @@ void kfree(unsigned int);
 void page_lock(struct page *);
 void page_unlock(struct page *);
 struct page *get_free_page(void);
+struct page *get_zeroed_page(void);
+int zero_free_pages(void);
+struct page *get_contig_pages(int);
 struct page *search_page_hash(struct inode *, __off_t);
+struct page *get_cached_page(struct inode *, __off_t);
 void release_page(struct page *);
 int is_valid_page(int);
 void invalidate_inode_pages(struct inode *);
-void update_page_cache(struct inode *, __off_t, const char *, int);
+void age_page_cache(void);
+void truncate_inode_pages(struct inode *, __off_t);
+int write_page_block(struct inode *, __off_t, __blk_t, const char *, int);
 int write_page(struct page *, struct inode *, __off_t, unsigned int);
 int bread_page(struct page *, struct inode *, __off_t, char, char);
+void page_readahead(struct inode *, __off_t, int);
+void drop_inode_pages(struct inode *, __off_t, __off_t);
 int file_read(struct inode *, struct fd *, char *, __size_t);
 void reserve_pages(unsigned int, unsigned int);
 void page_init(int);
@@ -106,11 +162,15 @@ unsigned int map_kaddr(unsigned int *,unsigned int, unsigned int, unsigned int,
 void bss_init(void);
 unsigned int setup_tmp_pgdir(unsigned int, unsigned int);
 unsigned int get_mapped_addr(struct proc *, unsigned int);
+int unshare_page_table(struct proc *, unsigned int);
+void release_shared_page_tables(struct proc *);
 int clone_pages(struct proc *);
 int free_page_tables(struct proc *);
 unsigned int map_page(struct proc *, unsigned int, unsigned int, unsigned int);
 unsigned int map_page_flags(struct proc *, unsigned int, unsigned int, unsigned int, int);
 int unmap_page(unsigned int);
+int move_page_range(unsigned int, unsigned int, __size_t);
+void invalidate_tlb_page(unsigned int);
 void mem_init(void);
 void mem_stats(void);
 
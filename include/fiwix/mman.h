@@ -9,6 +9,7 @@
 #define _FIWIX_MMAN_H
 
 #include <fiwix/fs.h>
+#include <fiwix/sleep.h>
 
 #define PROT_READ	0x1		/* page can be read */
 #define PROT_WRITE	0x2		/* page can be written */
@@ -33,9 +34,18 @@
 #define MS_INVALIDATE	0x2	/* invalidate the caches */
 #define MS_SYNC		0x4	/* synchronous memory sync */
 
+#define MREMAP_MAYMOVE	1	/* the mapping can be moved */
+#define MREMAP_FIXED	2	/* move the mapping to the given address */
+
 #define MCL_CURRENT	1	/* lock all current mappings */
 #define MCL_FUTURE	2	/* lock all future mappings */
 
+#define MADV_NORMAL	0	/* no special treatment */
+#define MADV_RANDOM	1	/* expect random page references */
+#define MADV_SEQUENTIAL	2	/* expect sequential page references */
+#define MADV_WILLNEED	3	/* will need these pages */
+#define MADV_DONTNEED	4	/* don't need these pages */
+
 #define P_TEXT		1	/* text section */
 #define P_DATA		2	/* data section */
 #define P_BSS		3	/* BSS section */
@@ -57,9 +67,39 @@ struct mmap {
 	unsigned int offset;
 };
 
+/* an address space, shared by the processes created with CLONE_VM */
+struct mm {
+	int count;			/* processes pointing to it */
+	int users;			/* live processes running on it */
+	struct resource lock;		/* serializes the changes to the vmas */
+	struct proc *owner;		/* process holding the lock */
+	int depth;			/* nested locks taken by the owner */
+	struct vma *vma_table;		/* virtual memory-map addresses */
+	struct vma *vma_tree;		/* vma_table indexed by start address */
+	struct vma *vma_hint;		/* last vma found */
+	unsigned int brk_lower;		/* lower limit of the heap section */
+	unsigned int brk;		/* current limit of the heap */
+	unsigned int rss;
+};
+
+extern struct slab_cache *vma_cache;
+extern struct slab_cache *mm_cache;
+extern struct mm kernel_mm;
+
 void show_vma_regions(struct proc *);
+int writeback_vma_pages(struct vma *, unsigned int, unsigned int);
+void writeback_shared_mappings(void);
 void free_vma_pages(struct vma *, unsigned int, __size_t);
+struct mm *alloc_mm(void);
+void put_mm(struct mm *);
+void lock_mm(struct mm *);
+void unlock_mm(struct mm *);
+int is_vm_shared(struct proc *);
+int leave_vm(void);
 void release_binary(void);
+void build_vma_tree(struct proc *);
+void update_vma_region(struct vma *);
+struct vma *find_proc_vma_region(struct proc *, unsigned int);
 struct vma *find_vma_region(unsigned int);
 struct vma *find_vma_intersection(unsigned int, unsigned int);
 int expand_heap(unsigned int);
@@ -67,5 +107,8 @@ unsigned int get_unmapped_vma_region(unsigned int);
 int do_mmap(struct inode *, unsigned int, unsigned int, unsigned int, unsigned int, unsigned int, char, char, void *);
 int do_munmap(unsigned int, __size_t);
 int do_mprotect(struct vma *, unsigned int, __size_t, int);
+int do_madvise(unsigned int, __size_t, int);
+int do_mremap(unsigned int, __size_t, __size_t, int, unsigned int);
+int do_msync(unsigned int, __size_t, int);
 
 #endif /* _FIWIX_MMAN_H */
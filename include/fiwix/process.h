@@ -17,9 +17,14 @@ struct vma {
 	char s_type;		/* segment type (P_TEXT, P_DATA, ...) */
 	struct inode *inode;	/* file inode */
 	char o_mode;		/* open mode (O_RDONLY, O_RDWR, ...) */
+	char advice;		/* MADV_NORMAL, MADV_RANDOM, ... */
 	void *object;		/* generic pointer (currently only for shm) */
 	struct vma *prev;
 	struct vma *next;
+	struct vma *left;	/* vma_tree links */
+	struct vma *right;
+	unsigned int max_gap;	/* biggest hole below a vma of this subtree */
+	int height;
 };
 
 #include <fiwix/config.h>
@@ -41,6 +46,15 @@ struct vma {
 #define PF_PEXEC	0x00000002	/* has performed a sys_execve() */
 #define PF_USEREAL	0x00000004	/* use real UID in permission checks */
 #define PF_NOTINTERRUPT	0x00000008	/* non-interruptible sleeping */
+#define PF_VFORK	0x00000010	/* parent suspended until execve/exit */
+
+/* clone() flags */
+#define CSIGNAL		0x000000FF	/* signal sent to the parent on exit */
+#define CLONE_VM	0x00000100	/* share the address space */
+#define CLONE_FS	0x00000200	/* share root, cwd and umask */
+#define CLONE_FILES	0x00000400	/* share the file descriptors */
+#define CLONE_SIGHAND	0x00000800	/* share the signal handlers */
+#define CLONE_VFORK	0x00004000	/* suspend the parent until execve/exit */
 
 #define MMAP_START	0x40000000	/* mmap()s start at 1GB */
 #define IS_SUPERUSER	(current->euid == 0)
@@ -70,6 +84,25 @@ struct binargs {
 	int offset;
 };
 
+/* the following tables can be shared between processes with clone() */
+struct files {
+	int count;			/* processes sharing this table */
+	unsigned short int fd[OPEN_MAX];
+	unsigned char fd_flags[OPEN_MAX];
+};
+
+struct fs {
+	int count;			/* processes sharing this table */
+	struct inode *root;
+	struct inode *pwd;		/* process working directory */
+	__mode_t umask;
+};
+
+struct sighand {
+	int count;			/* processes sharing this table */
+	struct sigaction action[NSIG];
+};
+
 /* Intel 386 Task Switch State */
 struct i386tss {
 	unsigned int prev_tss;
@@ -115,6 +148,13 @@ struct proc {
 	int state;			/* process state */
 	int priority;
 	int cpu_count;			/* time of process running */
+	int prio;			/* run queue level */
+	int nice;
+	int policy;			/* scheduling policy */
+	int rt_priority;		/* real-time priority */
+	int sleep_avg;			/* ticks of the interactivity bonus */
+	unsigned int sleep_start;	/* ticks when it went to sleep */
+	struct prio_array *array;	/* run queue array it's queued in */
 	__time_t start_time;
 	int exit_code;	
 	void *sleep_address;
@@ -124,10 +164,8 @@ struct proc {
 	unsigned short int egid;	/* effective group ID */
 	unsigned short int suid;	/* saved user ID */
 	unsigned short int sgid;	/* saved group ID */
-	unsigned short int fd[OPEN_MAX];
-	unsigned char fd_flags[OPEN_MAX];
-	struct inode *root;
-	struct inode *pwd;		/* process working directory */
+	struct files *files;		/* file descriptors (CLONE_FILES) */
+	struct fs *fs;			/* root, cwd and umask (CLONE_FS) */
 	unsigned int entry_address;
 	char argv0[NAME_MAX + 1];
 	int argc;
@@ -135,24 +173,20 @@ struct proc {
 	int envc;
 	char **envp;
 	char pidstr[5];			/* PID number converted to string */
-	struct vma *vma_table;		/* virtual memory-map addresses */
-	unsigned int brk_lower;		/* lower limit of the heap section */
-	unsigned int brk;		/* current limit of the heap */
+	struct mm *mm;			/* address space (CLONE_VM) */
 	__sigset_t sigpending;
 	__sigset_t sigblocked;
 	__sigset_t sigexecuting;
-	struct sigaction sigaction[NSIG];
+	struct sighand *sighand;	/* signal handlers (CLONE_SIGHAND) */
 	struct sigcontext sc[NSIG];	/* each signal has its own context */
 	unsigned int sp;		/* current process' stack frame */
 	struct rusage usage;		/* process resource usage */
 	struct rusage cusage;		/* children resource usage */
-	unsigned int it_real_interval, it_real_value;
+	unsigned int it_real_interval;	/* ITIMER_REAL runs as a callout */
 	unsigned int it_virt_interval, it_virt_value;
 	unsigned int it_prof_interval, it_prof_value;
-	unsigned int timeout;
+	unsigned int timeout;		/* sleep timeout, 0 once expired */
 	struct rlimit rlim[RLIM_NLIMITS];
-	unsigned int rss;
-	__mode_t umask;
 	unsigned char loopcnt;		/* nested symlinks counter */
 #ifdef CONFIG_SYSVIPC
 	struct sem_undo *semundo;
@@ -163,11 +197,17 @@ struct proc {
 	struct proc *next_sleep;
 	struct proc *prev_run;
 	struct proc *next_run;
+	struct proc *prev_rq;
+	struct proc *next_rq;
 };
 
 extern struct proc *current;
 extern struct proc *proc_table;
 
+extern struct files kernel_files;
+extern struct fs kernel_fs;
+extern struct sighand kernel_sighand;
+
 int can_signal(struct proc *);
 int send_sig(struct proc *, __sigset_t);
 
@@ -182,6 +222,16 @@ void release_proc(struct proc *);
 int get_unused_pid(void);
 struct proc *get_proc_by_pid(__pid_t);
 
+struct files *copy_files(struct files *);
+int unshare_files(void);
+void exit_files(void);
+struct fs *copy_fs(struct fs *);
+void exit_fs(void);
+struct sighand *copy_sighand(struct sighand *);
+int unshare_sighand(void);
+void exit_sighand(void);
+void release_tables(struct proc *);
+
 struct proc *kernel_process(const char *, int (*fn)(void));
 void proc_slot_init(struct proc *);
 void proc_init(void);
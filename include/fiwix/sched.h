@@ -14,6 +14,14 @@
 #define PRIO_PGRP	1
 #define PRIO_USER	2
 
+#define SCHED_OTHER	0
+#define SCHED_FIFO	1
+#define SCHED_RR	2
+
+struct sched_param {
+	int sched_priority;
+};
+
 #define PROC_RUNNING	1
 #define PROC_SLEEPING	2
 #define PROC_ZOMBIE	3
@@ -25,6 +33,33 @@
 
 #define DEF_PRIORITY	(20 * HZ / 100)	/* 200ms of time slice */
 
+/*
+ * Levels 0 to MAX_RT_PRIO - 1 are reserved for the real-time processes
+ * (SCHED_FIFO and SCHED_RR), so they always preempt the normal ones.
+ */
+#define MAX_RT_PRIO	100		/* real-time priorities are 1 to 99 */
+#define NR_PRIO		(MAX_RT_PRIO + 40)	/* number of run queue levels */
+#define DEF_PRIO	(MAX_RT_PRIO + 20)	/* level of ordinary processes */
+#define PRIO_BITMAP_SIZE	((NR_PRIO + 31) / 32)
+
+#define MIN_NICE	-20
+#define MAX_NICE	19
+#define NICE_TO_PRIO(nice)	(DEF_PRIO + (nice))
+
+#define MAX_SLEEP_AVG	HZ		/* sleep time that earns the full bonus */
+#define MAX_BONUS	10		/* range of the interactivity bonus */
+
+/*
+ * A set of run queues, one per priority level (0 is the highest). A bit is
+ * set in 'bitmap' for each level with at least one process queued.
+ */
+struct prio_array {
+	int nr_procs;
+	unsigned int bitmap[PRIO_BITMAP_SIZE];
+	struct proc *head[NR_PRIO];
+	struct proc *tail[NR_PRIO];
+};
+
 extern int need_resched;
 
 #define SI_LOAD_SHIFT   16
@@ -48,6 +83,12 @@ extern unsigned int avenrun[3];		/* Load averages */
 /* ------------------------------------------------------------------------ */
 
 
+int effective_prio(struct proc *);
+void set_nice(struct proc *, int);
+void set_scheduler(struct proc *, int, int);
+void do_sched_yield(void);
+void enqueue_proc(struct proc *);
+void dequeue_proc(struct proc *);
 void do_sched(void);
 void set_tss(struct proc *);
 void sched_init(void);
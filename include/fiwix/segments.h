@@ -22,6 +22,10 @@
 #define PAGE_PRESENT	0x001	/* Present */
 #define PAGE_RW		0x002	/* Read/Write */
 #define PAGE_USER	0x004	/* User */
+#define PAGE_ACCESSED	0x020	/* Accessed */
+#define PAGE_DIRTY	0x040	/* Dirty */
+#define PAGE_4MB	0x080	/* 4MB page (only in Page Directory entries) */
+#define PAGE_GLOBAL	0x100	/* Global (kept in TLB on CR3 reloads) */
 #define PAGE_NOALLOC	0x200	/* No Page Allocated (OS managed) */
 
 #ifndef ASM_FILE
@@ -20,6 +20,8 @@
 #define IS_NUMERIC(c)	((c) >= '0' && (c) <= '9')
 #define IS_SPACE(c)	((c) == ' ')
 
+#define MEMOP_SMALL	16	/* copies below this size don't use 'rep' */
+
 void swap_asc_word(char *, int);
 int strcmp(const char *, const char *);
 int strncmp(const char *, const char *, __ssize_t);
@@ -38,5 +40,7 @@ void memcpy_l(void *, const void *, unsigned int);
 void memset_b(void *, unsigned char, unsigned int);
 void memset_w(void *, unsigned short int, unsigned int);
 void memset_l(void *, unsigned int, unsigned int);
+void copy_page(void *, const void *);
+void clear_page(void *);
 
 #endif /* _INCLUDE_STRING_H */
@@ -0,0 +1,76 @@
+/*
+ * fiwix/include/fiwix/swap.h
+ *
+ * Copyright 2024, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#ifndef _FIWIX_SWAP_H
+#define _FIWIX_SWAP_H
+
+#include <fiwix/config.h>
+#include <fiwix/types.h>
+#include <fiwix/fs.h>
+#include <fiwix/devices.h>
+#include <fiwix/process.h>
+
+#define SWAP_SIGNATURE		"SWAPSPACE2"
+#define SWAP_SIGNATURE_LEN	10
+
+#define SWAP_MAP_MAX		0xFE	/* max. references to a slot */
+#define SWAP_MAP_BAD		0xFF	/* header or bad slot */
+
+/* swap area flags */
+#define SWP_USED		0x01
+#define SWP_WRITEOK		0x02
+
+/*
+ * A swapped out page keeps its location in the (non-present) page table
+ * entry:
+ *
+ *  31                             12 11           6 5           1  0
+ * +--------------------------------+--------------+-------------+---+
+ * |       slot (page offset)       |       0      |  swap area  | 0 |
+ * +--------------------------------+--------------+-------------+---+
+ */
+#define SWP_ENTRY(type, offset)	(((type) << 1) | ((offset) << PAGE_SHIFT))
+#define SWP_TYPE(entry)		(((entry) >> 1) & 0x1F)
+#define SWP_OFFSET(entry)	((entry) >> PAGE_SHIFT)
+#define IS_SWP_ENTRY(pte)	((pte) && !((pte) & PAGE_PRESENT))
+
+/* header written by mkswap(8) in the first page of the swap area */
+struct swap_header {
+	char bootbits[1024];
+	unsigned int version;
+	unsigned int last_page;
+	unsigned int nr_badpages;
+	unsigned char uuid[16];
+	char volume_name[16];
+	unsigned int padding[117];
+	unsigned int badpages[1];
+};
+
+struct swap_area {
+	int flags;
+	struct inode *inode;		/* block device or regular file */
+	__dev_t dev;			/* device where the slots are */
+	struct device *device;
+	int blksize;			/* size of each I/O request */
+	__blk_t *blocks;		/* blocks of a swap file (no holes) */
+	unsigned char *map;		/* references to each slot */
+	unsigned int pages;		/* number of slots */
+	unsigned int next;		/* next slot to look for */
+};
+
+extern struct swap_area swap_table[NR_SWAP_AREAS];
+
+int is_swapped(struct proc *, unsigned int);
+unsigned int get_swap_page(void);
+void swap_duplicate(unsigned int);
+void swap_free(unsigned int);
+int swap_in(struct vma *, unsigned int);
+int swap_out(int);
+int do_swapon(struct inode *);
+int do_swapoff(struct inode *);
+
+#endif /* _FIWIX_SWAP_H */
@@ -24,6 +24,7 @@
 #include <fiwix/sigcontext.h>
 #include <fiwix/mman.h>
 #include <fiwix/ipc.h>
+#include <fiwix/sched.h>
 
 #define NR_SYSCALLS	(sizeof(syscall_table) / sizeof(unsigned int))
 
@@ -37,8 +38,12 @@ int sys_exit(int);
 void do_exit(int);
 #ifdef CONFIG_SYSCALL_6TH_ARG
 int sys_fork(int, int, int, int, int, int, struct sigcontext *);
+int sys_vfork(int, int, int, int, int, int, struct sigcontext *);
+int sys_clone(unsigned int, unsigned int, int, int, int, int, struct sigcontext *);
 #else
 int sys_fork(int, int, int, int, int, struct sigcontext *);
+int sys_vfork(int, int, int, int, int, struct sigcontext *);
+int sys_clone(unsigned int, unsigned int, int, int, int, struct sigcontext *);
 #endif /* CONFIG_SYSCALL_6TH_ARG */
 int sys_read(unsigned int, char *, int);
 int sys_write(unsigned int, const char *, int);
@@ -71,6 +76,7 @@ int sys_fstat(unsigned int, struct old_stat *);
 int sys_pause(void);
 int sys_utime(const char *, struct utimbuf *);
 int sys_access(const char *, __mode_t);
+int sys_nice(int);
 int sys_ftime(struct timeb *);
 void sys_sync(void);
 int sys_kill(__pid_t, __sigset_t);
@@ -117,6 +123,7 @@ int old_select(unsigned int *);
 int sys_symlink(const char *, const char *);
 int sys_lstat(const char *, struct old_stat *);
 int sys_readlink(const char *, char *, __size_t);
+int sys_swapon(const char *, int);
 int sys_reboot(int, int, int);
 int old_mmap(struct mmap *);
 int sys_munmap(unsigned int, __size_t);
@@ -124,6 +131,8 @@ int sys_truncate(const char *, __off_t);
 int sys_ftruncate(unsigned int, __off_t);
 int sys_fchmod(unsigned int, __mode_t);
 int sys_fchown(unsigned int, __uid_t, __gid_t);
+int sys_getpriority(int, int);
+int sys_setpriority(int, int, int);
 int sys_statfs(const char *, struct statfs *);
 int sys_fstatfs(unsigned int, struct statfs *);
 int sys_ioperm(unsigned int, unsigned int, int);
@@ -140,6 +149,7 @@ int sys_iopl(int, int, int, int, int, int, struct sigcontext *);
 int sys_iopl(int, int, int, int, int, struct sigcontext *);
 #endif /* CONFIG_SYSCALL_6TH_ARG */
 int sys_wait4(__pid_t, int *, int, struct rusage *);
+int sys_swapoff(const char *);
 int sys_sysinfo(struct sysinfo *);
 #ifdef CONFIG_SYSVIPC
 int sys_ipc(unsigned int, struct sysvipc_args *);
@@ -163,11 +173,21 @@ int sys_llseek(unsigned int, unsigned int, unsigned int, __loff_t *, unsigned in
 int sys_getdents(unsigned int, struct dirent *, unsigned int);
 int sys_select(int, fd_set *, fd_set *, fd_set *, struct timeval *);
 int sys_flock(unsigned int, int);
+int sys_msync(unsigned int, __size_t, int);
 int sys_readv(int, struct iovec *, int);
 int sys_writev(int, struct iovec *, int);
 int sys_getsid(__pid_t);
 int sys_fdatasync(int);
+int sys_sched_setparam(__pid_t, const struct sched_param *);
+int sys_sched_getparam(__pid_t, struct sched_param *);
+int sys_sched_setscheduler(__pid_t, int, const struct sched_param *);
+int sys_sched_getscheduler(__pid_t);
+int sys_sched_yield(void);
+int sys_sched_get_priority_max(int);
+int sys_sched_get_priority_min(int);
+int sys_sched_rr_get_interval(__pid_t, struct timespec *);
 int sys_nanosleep(const struct timespec *, struct timespec *);
+int sys_mremap(unsigned int, __size_t, __size_t, int, unsigned int);
 int sys_chown(const char *, __uid_t, __gid_t);
 int sys_getcwd(char *, __size_t);
 #ifdef CONFIG_MMAP2
@@ -179,8 +199,10 @@ int sys_stat64(const char *, struct stat64 *);
 int sys_lstat64(const char *, struct stat64 *);
 int sys_fstat64(unsigned int, struct stat64 *);
 int sys_chown32(const char *, unsigned int, unsigned int);
+int sys_madvise(unsigned int, __size_t, int);
 int sys_getdents64(unsigned int, struct dirent64 *, unsigned int);
 int sys_fcntl64(unsigned int, int, unsigned int);
+int sys_fadvise64(unsigned int, __loff_t, __size_t, int);
 int sys_utimes(const char *, struct timeval times[2]);
 
 #endif /* _FIWIX_SYSCALLS_H */
@@ -43,6 +43,7 @@ struct mt {
 
 unsigned int tv2ticks(const struct timeval *);
 void ticks2tv(int, struct timeval *);
+int getitimer(int, struct itimerval *);
 int setitimer(int, const struct itimerval *, struct itimerval *);
 unsigned int mktime(struct mt *);
 
@@ -11,6 +11,8 @@
 #include <fiwix/types.h>
 #include <fiwix/sigcontext.h>
 
+struct proc;
+
 #define TIMER_IRQ	0
 #define HZ		100	/* kernel's Hertz rate (100 = 10ms) */
 #define TICK		(1000000 / HZ)
@@ -27,10 +29,14 @@
 #define INFINITE_WAIT	0xFFFFFFFF
 
 struct callout {
-	int expires;
+	unsigned int expires;		/* tick of expiration */
 	void (*fn)(unsigned int);
 	unsigned int arg;
+	struct callout **slot;		/* wheel slot where it's queued */
+	struct callout *prev;
 	struct callout *next;
+	struct callout *prev_hash;
+	struct callout *next_hash;
 };
 
 struct callout_req {
@@ -40,6 +46,12 @@ struct callout_req {
 
 void add_callout(struct callout_req *, unsigned int);
 void del_callout(struct callout_req *);
+unsigned int get_callout(struct callout_req *);
+void set_timeout(struct proc *, unsigned int);
+unsigned int del_timeout(struct proc *);
+void del_proc_callouts(struct proc *);
+void timer_idle_enter(void);
+void timer_idle_exit(void);
 void irq_timer(int, struct sigcontext *);
 void irq_timer_bh(struct sigcontext *);
 void do_callouts_bh(struct sigcontext *);
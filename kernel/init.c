@@ -9,6 +9,7 @@
 #include <fiwix/kernel.h>
 #include <fiwix/system.h>
 #include <fiwix/mm.h>
+#include <fiwix/mman.h>
 #include <fiwix/timer.h>
 #include <fiwix/sched.h>
 #include <fiwix/sleep.h>
@@ -55,12 +56,16 @@ void init_init(void)
 	/* INIT slot was already created in main.c */
 	init = &proc_table[INIT];
 
+	if(!(init->mm = alloc_mm())) {
+		goto init_init__die;
+	}
+
 	/* INIT process starts with the current (kernel) Page Directory */
 	if(!(pgdir = (void *)kmalloc(PAGE_SIZE))) {
 		goto init_init__die;
 	}
-	init->rss++;
-	memcpy_b(pgdir, kpage_dir, PAGE_SIZE);
+	init->mm->rss++;
+	copy_page(pgdir, kpage_dir);
 	init->tss.cr3 = V2P((unsigned int)pgdir);
 
 	init->ppid = &proc_table[IDLE];
@@ -69,22 +74,31 @@ void init_init(void)
 	init->flags = 0;
 	init->children = 0;
 	init->priority = DEF_PRIORITY;
+	init->prio = DEF_PRIO;
+	init->nice = 0;
+	init->policy = SCHED_OTHER;
+	init->rt_priority = 0;
+	init->sleep_avg = MAX_SLEEP_AVG / 2;
 	init->start_time = CURRENT_TICKS;
 	init->sleep_address = NULL;
 	init->uid = init->gid = 0;
 	init->euid = init->egid = 0;
 	init->suid = init->sgid = 0;
-	memset_b(init->fd, 0, sizeof(init->fd));
-	memset_b(init->fd_flags, 0, sizeof(init->fd_flags));
-	init->root = current->root;
-	init->pwd = current->pwd;
+	if(!(init->files = copy_files(&kernel_files))) {
+		goto init_init__die;
+	}
+	if(!(init->fs = copy_fs(&kernel_fs))) {
+		goto init_init__die;
+	}
+	if(!(init->sighand = copy_sighand(&kernel_sighand))) {
+		goto init_init__die;
+	}
 	strcpy(init->argv0, init_argv[0]);
 	init_argv[1] = init_args;
 	sprintk(init->pidstr, "%d", init->pid);
 	init->sigpending = 0;
 	init->sigblocked = 0;
 	init->sigexecuting = 0;
-	memset_b(init->sigaction, 0, sizeof(init->sigaction));
 	memset_b(&init->usage, 0, sizeof(struct rusage));
 	memset_b(&init->cusage, 0, sizeof(struct rusage));
 	init->timeout = 0;
@@ -95,14 +109,14 @@ void init_init(void)
 	init->rlim[RLIMIT_NOFILE].rlim_max = NR_OPENS;
 	init->rlim[RLIMIT_NPROC].rlim_cur = CHILD_MAX;
 	init->rlim[RLIMIT_NPROC].rlim_max = NR_PROCS;
-	init->umask = 0022;
+	init->fs->umask = 0022;
 
 	/* setup the stack */
 	if(!(init->tss.esp0 = kmalloc(PAGE_SIZE))) {
 		goto init_init__die;
 	}
 	init->tss.esp0 += PAGE_SIZE - 4;
-	init->rss++;
+	init->mm->rss++;
 	init->tss.ss0 = KERNEL_DS;
 
 	/* setup the init_trampoline */
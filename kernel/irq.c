@@ -14,9 +14,11 @@
 #include <fiwix/string.h>
 #include <fiwix/sigcontext.h>
 #include <fiwix/sleep.h>
+#include <fiwix/timer.h>
 
 struct interrupt *irq_table[NR_IRQS];
 static struct bh *bh_table = NULL;
+int in_interrupt = 0;		/* nesting of interrupt handlers and bottom halves */
 
 int register_irq(int num, struct interrupt *new_irq)
 {
@@ -92,6 +94,7 @@ void irq_handler(int num, struct sigcontext sc)
 	struct interrupt *irq;
 
 	disable_irq(num);
+	in_interrupt++;
 
 	irq = irq_table[num];
 
@@ -103,6 +106,11 @@ void irq_handler(int num, struct sigcontext sc)
 
 	ack_pic_irq(num);
 
+	/* catch up the ticks skipped while idle before anything else */
+	if(num != TIMER_IRQ) {
+		timer_idle_exit();
+	}
+
 	kstat.irqs++;
 	irq->ticks++;
 	do {
@@ -111,6 +119,7 @@ void irq_handler(int num, struct sigcontext sc)
 	} while(irq);
 
 end:
+	in_interrupt--;
 	enable_irq(num);
 }
 
@@ -126,6 +135,7 @@ void do_bh(struct sigcontext sc)
 	struct bh *b;
 	void (*fn)(struct sigcontext *);
 
+	in_interrupt++;
 	b = bh_table;
 	while(b) {
 		if(b->flags & BH_ACTIVE) {
@@ -135,6 +145,7 @@ void do_bh(struct sigcontext sc)
 		}
 		b = b->next;
 	}
+	in_interrupt--;
 }
 
 void irq_init(void)
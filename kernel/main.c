@@ -22,6 +22,7 @@
 #include <fiwix/segments.h>
 #include <fiwix/devices.h>
 #include <fiwix/buffer.h>
+#include <fiwix/blk_queue.h>
 #include <fiwix/cpu.h>
 #include <fiwix/timer.h>
 #include <fiwix/sleep.h>
@@ -30,6 +31,7 @@
 #include <fiwix/keyboard.h>
 #include <fiwix/sched.h>
 #include <fiwix/mm.h>
+#include <fiwix/mman.h>
 #include <fiwix/ipc.h>
 #include <fiwix/kexec.h>
 #include <fiwix/sysconsole.h>
@@ -44,6 +46,7 @@ char kparm_initrd[DEVNAME_MAX + 1];
 int kparm_syscondev = 0;
 char kparm_bgaresolution[15];
 int kparm_ro;
+int kparm_faultaround = FAULT_AROUND_PAGES;
 
 unsigned int _last_data_addr;
 char *init_args;
@@ -122,8 +125,10 @@ void start_kernel(unsigned int magic, unsigned int info, unsigned int last_boot_
 	proc_init();
 	sleep_init();
 	buffer_init();
+	blk_queue_init();
 	sched_init();
 	inode_init();
+	namei_init();
 	fd_init();
 
 #ifdef CONFIG_SYSVIPC
@@ -143,6 +148,10 @@ void start_kernel(unsigned int magic, unsigned int info, unsigned int last_boot_
 	set_tss(current);
 	load_tr(TSS);
 	current->tss.cr3 = V2P((unsigned int)kpage_dir);
+	current->files = &kernel_files;
+	current->fs = &kernel_fs;
+	current->sighand = &kernel_sighand;
+	current->mm = &kernel_mm;
 	current->flags |= PF_KPROC;
 	sprintk(current->argv0, "%s", "idle");
 
@@ -150,6 +159,7 @@ void start_kernel(unsigned int magic, unsigned int info, unsigned int last_boot_
 	init = get_proc_free();
 	proc_slot_init(init);
 	init->pid = get_unused_pid();
+	init->mm = &kernel_mm;	/* until init_init() gives it its own */
 
 	kernel_process("kswapd", kswapd);	/* PID 2 */
 	kernel_process("kbdflushd", kbdflushd);	/* PID 3 */
@@ -214,6 +224,17 @@ void cpu_idle()
 		if(need_resched) {
 			do_sched();
 		}
-		HLT();
+		/* use the idle time to prepare zero-filled pages */
+		if(zero_free_pages()) {
+			continue;
+		}
+		CLI();
+		/* an interrupt might have woken up a process meanwhile */
+		if(need_resched) {
+			STI();
+			continue;
+		}
+		timer_idle_enter();
+		STI_HLT();
 	}
 }
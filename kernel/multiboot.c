@@ -59,6 +59,13 @@ static int check_parm(struct kparms *parm, const char *value)
 		}
 		return 1;
 	}
+	if(!strcmp(parm->name, "faultaround=")) {
+		if(value[0]) {
+			kparm_faultaround = MIN(atoi(value), PT_ENTRIES);
+			return 0;
+		}
+		return 1;
+	}
 	if(!strcmp(parm->name, "initrd=")) {
 		if(value[0]) {
 			strncpy(kparm_initrd, value, DEVNAME_MAX);
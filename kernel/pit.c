@@ -32,6 +32,28 @@ int pit_getcounter0(void)
 	return count;
 }
 
+/* programs a single interrupt after 'count' oscillations */
+void pit_oneshot(unsigned short int count)
+{
+	outport_b(MODEREG, SEL_CHAN0 | LSB_MSB | TERM_COUNT | BINARY_CTR);
+	outport_b(CHANNEL0, count & 0xFF);	/* LSB */
+	outport_b(CHANNEL0, count >> 8);	/* MSB */
+}
+
+/*
+ * Resumes the periodic interrupt with a first period of 'count' oscillations.
+ * The rate generator loads a count written while it's running only at the
+ * end of the current period, so the next ones will last OSCIL / hertz.
+ */
+void pit_periodic(unsigned short int count, unsigned short int hertz)
+{
+	outport_b(MODEREG, SEL_CHAN0 | LSB_MSB | RATE_GEN | BINARY_CTR);
+	outport_b(CHANNEL0, count & 0xFF);		/* LSB */
+	outport_b(CHANNEL0, count >> 8);		/* MSB */
+	outport_b(CHANNEL0, (OSCIL / hertz) & 0xFF);	/* LSB */
+	outport_b(CHANNEL0, (OSCIL / hertz) >> 8);	/* MSB */
+}
+
 void pit_init(unsigned short int hertz)
 {
 	outport_b(MODEREG, SEL_CHAN0 | LSB_MSB | RATE_GEN | BINARY_CTR);
@@ -7,8 +7,12 @@
 
 #include <fiwix/kernel.h>
 #include <fiwix/mm.h>
+#include <fiwix/mman.h>
 #include <fiwix/errno.h>
 #include <fiwix/process.h>
+#include <fiwix/fd.h>
+#include <fiwix/fs.h>
+#include <fiwix/syscalls.h>
 #include <fiwix/timer.h>
 #include <fiwix/sched.h>
 #include <fiwix/sleep.h>
@@ -30,6 +34,15 @@ static struct resource pid_resource = { 0, 0 };
 int nr_processes = 0;
 __pid_t lastpid = 0;
 
+/* tables of IDLE and the kernel processes */
+struct files kernel_files = { 1 };
+struct fs kernel_fs = { 1 };
+struct sighand kernel_sighand = { 1 };
+
+static struct slab_cache *files_cache;
+static struct slab_cache *fs_cache;
+static struct slab_cache *sighand_cache;
+
 /* sum up child (and its children) statistics */
 void add_crusage(struct proc *p, struct rusage *cru)
 {
@@ -70,7 +83,7 @@ void get_rusage(struct proc *p, struct rusage *ru)
 	 * then the child statistics should not be added to the values returned
 	 * by RUSAGE_CHILDREN.
 	 */
-	if(current->sigaction[SIGCHLD - 1].sa_handler == SIG_IGN) {
+	if(current->sighand->action[SIGCHLD - 1].sa_handler == SIG_IGN) {
 		return;
 	}
 
@@ -133,9 +146,9 @@ __pid_t remove_zombie(struct proc *p)
 
 	pid = p->pid;
 	kfree(p->tss.esp0);
-	p->rss--;
+	p->mm->rss--;
 	kfree(P2V(p->tss.cr3));
-	p->rss--;
+	put_mm(p->mm);
 	pp = p->ppid;
 	release_proc(p);
 	if(pp) {
@@ -273,6 +286,148 @@ struct proc *get_proc_by_pid(__pid_t pid)
 	return NULL;
 }
 
+struct files *copy_files(struct files *old)
+{
+	struct files *files;
+	int n;
+
+	if(!(files = (struct files *)slab_alloc(files_cache))) {
+		return NULL;
+	}
+	*files = *old;
+	files->count = 1;
+
+	/* increase file descriptors usage */
+	for(n = 0; n < OPEN_MAX; n++) {
+		if(files->fd[n]) {
+			fd_table[files->fd[n]].count++;
+		}
+	}
+	return files;
+}
+
+/* gives the current process its own copy of a shared fd table */
+int unshare_files(void)
+{
+	struct files *files;
+
+	if(current->files->count < 2) {
+		return 0;
+	}
+	if(!(files = copy_files(current->files))) {
+		return -ENOMEM;
+	}
+	current->files->count--;
+	current->files = files;
+	return 0;
+}
+
+void exit_files(void)
+{
+	int n;
+
+	if(!--current->files->count) {
+		for(n = 0; n < OPEN_MAX; n++) {
+			if(current->files->fd[n]) {
+				sys_close(n);
+			}
+		}
+		slab_free(files_cache, current->files);
+	}
+	current->files = NULL;
+}
+
+struct fs *copy_fs(struct fs *old)
+{
+	struct fs *fs;
+
+	if(!(fs = (struct fs *)slab_alloc(fs_cache))) {
+		return NULL;
+	}
+	*fs = *old;
+	fs->count = 1;
+	if(fs->root) {
+		fs->root->count++;
+	}
+	if(fs->pwd) {
+		fs->pwd->count++;
+	}
+	return fs;
+}
+
+void exit_fs(void)
+{
+	if(!--current->fs->count) {
+		iput(current->fs->root);
+		iput(current->fs->pwd);
+		slab_free(fs_cache, current->fs);
+	}
+	current->fs = NULL;
+}
+
+struct sighand *copy_sighand(struct sighand *old)
+{
+	struct sighand *sighand;
+
+	if(!(sighand = (struct sighand *)slab_alloc(sighand_cache))) {
+		return NULL;
+	}
+	*sighand = *old;
+	sighand->count = 1;
+	return sighand;
+}
+
+/* gives the current process its own copy of shared signal handlers */
+int unshare_sighand(void)
+{
+	struct sighand *sighand;
+
+	if(current->sighand->count < 2) {
+		return 0;
+	}
+	if(!(sighand = copy_sighand(current->sighand))) {
+		return -ENOMEM;
+	}
+	current->sighand->count--;
+	current->sighand = sighand;
+	return 0;
+}
+
+void exit_sighand(void)
+{
+	struct sighand *sighand;
+
+	/* signals sent from now on are discarded (see send_sig()) */
+	sighand = current->sighand;
+	current->sighand = NULL;
+	if(!--sighand->count) {
+		slab_free(sighand_cache, sighand);
+	}
+}
+
+/* drops the tables taken by a process that couldn't be created */
+void release_tables(struct proc *p)
+{
+	int n;
+
+	if(p->files && !--p->files->count) {
+		for(n = 0; n < OPEN_MAX; n++) {
+			if(p->files->fd[n]) {
+				fd_table[p->files->fd[n]].count--;
+			}
+		}
+		slab_free(files_cache, p->files);
+	}
+	if(p->fs && !--p->fs->count) {
+		iput(p->fs->root);
+		iput(p->fs->pwd);
+		slab_free(fs_cache, p->fs);
+	}
+	if(p->sighand && !--p->sighand->count) {
+		slab_free(sighand_cache, p->sighand);
+	}
+}
+
 struct proc *kernel_process(const char *name, int (*fn)(void))
 {
 	struct proc *p;
@@ -283,13 +438,26 @@ struct proc *kernel_process(const char *name, int (*fn)(void))
 	p->ppid = &proc_table[IDLE];
 	p->flags |= PF_KPROC;
 	p->priority = DEF_PRIORITY;
+	p->prio = DEF_PRIO;
+	p->nice = 0;
+	p->policy = SCHED_OTHER;
+	p->rt_priority = 0;
+	p->sleep_avg = MAX_SLEEP_AVG / 2;
 	if(!(p->tss.esp0 = kmalloc(PAGE_SIZE))) {
 		release_proc(p);
 		return NULL;
 	}
 	p->tss.esp0 += PAGE_SIZE - 4;
-	p->rss++;
 	p->tss.cr3 = V2P((unsigned int)kpage_dir);
+	p->files = &kernel_files;
+	p->files->count++;
+	p->fs = &kernel_fs;
+	p->fs->count++;
+	p->sighand = &kernel_sighand;
+	p->sighand->count++;
+	p->mm = &kernel_mm;
+	p->mm->count++;
+	p->mm->users++;
 	p->tss.eip = (unsigned int)fn;
 	p->tss.esp = p->tss.esp0;
 	sprintk(p->pidstr, "%d", p->pid);
@@ -314,6 +482,8 @@ void proc_slot_init(struct proc *p)
 	}
 	p->prev_sleep = p->next_sleep = NULL;
 	p->prev_run = p->next_run = NULL;
+	p->prev_rq = p->next_rq = NULL;
+	p->array = NULL;
 	unlock_resource(&slot_resource);
 
 	memset_b(&p->tss, 0, sizeof(struct i386tss) - IO_BITMAP_SIZE);
@@ -345,4 +515,8 @@ void proc_init(void)
 		free_proc_slots++;
 	} while(n--);
 	proc_table_head = proc_table_tail = NULL;
+
+	files_cache = slab_cache_create("files", sizeof(struct files), NULL);
+	fs_cache = slab_cache_create("fs", sizeof(struct fs), NULL);
+	sighand_cache = slab_cache_create("sighand", sizeof(struct sighand), NULL);
 }
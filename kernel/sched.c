@@ -19,6 +19,10 @@
 extern struct seg_desc gdt[NR_GDT_ENTRIES];
 int need_resched = 0;
 
+static struct prio_array prio_arrays[2];
+static struct prio_array *active = &prio_arrays[0];
+static struct prio_array *expired = &prio_arrays[1];
+
 static void context_switch(struct proc *next)
 {
 	struct proc *prev;
@@ -43,39 +47,235 @@ void set_tss(struct proc *p)
 	g->sd_hibase = (char)(((unsigned int)&p->tss) >> 24);
 }
 
-/* Round Robin algorithm */
+/* returns the highest priority level with processes queued */
+static int first_prio(struct prio_array *array)
+{
+	int n, bit;
+
+	for(n = 0; n < PRIO_BITMAP_SIZE; n++) {
+		if(array->bitmap[n]) {
+			__asm__("bsfl %1, %0" : "=r" (bit) : "rm" (array->bitmap[n]));
+			return (n * 32) + bit;
+		}
+	}
+	return -1;
+}
+
+static void insert_rq(struct proc *p, struct prio_array *array)
+{
+	int prio;
+
+	prio = p->prio;
+	p->next_rq = NULL;
+	p->prev_rq = array->tail[prio];
+	if(array->tail[prio]) {
+		array->tail[prio]->next_rq = p;
+	} else {
+		array->head[prio] = p;
+		array->bitmap[prio / 32] |= 1 << (prio % 32);
+	}
+	array->tail[prio] = p;
+	array->nr_procs++;
+	p->array = array;
+}
+
+/* puts a process at the end of its level in the active array */
+void enqueue_proc(struct proc *p)
+{
+	unsigned int flags;
+
+	SAVE_FLAGS(flags); CLI();
+	insert_rq(p, active);
+	RESTORE_FLAGS(flags);
+}
+
+static void remove_rq(struct proc *p)
+{
+	struct prio_array *array;
+	int prio;
+
+	array = p->array;
+	prio = p->prio;
+	if(p->next_rq) {
+		p->next_rq->prev_rq = p->prev_rq;
+	} else {
+		array->tail[prio] = p->prev_rq;
+	}
+	if(p->prev_rq) {
+		p->prev_rq->next_rq = p->next_rq;
+	} else {
+		array->head[prio] = p->next_rq;
+	}
+	if(!array->head[prio]) {
+		array->bitmap[prio / 32] &= ~(1 << (prio % 32));
+	}
+	array->nr_procs--;
+	p->prev_rq = p->next_rq = NULL;
+	p->array = NULL;
+}
+
+/* time slice (in ticks) given to each nice value */
+static int nice_to_slice(int nice)
+{
+	int slice;
+
+	slice = (DEF_PRIORITY * (20 - nice)) / 20;
+	return slice > 0 ? slice : 1;
+}
+
+/*
+ * Returns the run queue level of a process: its static level (from the nice
+ * value) adjusted by a bonus of up to MAX_BONUS / 2 levels in each direction,
+ * depending on how much it has been sleeping lately. Interactive and I/O
+ * bound processes gain levels, CPU hogs lose them.
+ */
+int effective_prio(struct proc *p)
+{
+	int bonus, prio;
+
+	if(p->policy != SCHED_OTHER) {
+		return MAX_RT_PRIO - 1 - p->rt_priority;
+	}
+	bonus = (p->sleep_avg * MAX_BONUS / MAX_SLEEP_AVG) - (MAX_BONUS / 2);
+	prio = NICE_TO_PRIO(p->nice) - bonus;
+	if(prio < MAX_RT_PRIO) {
+		prio = MAX_RT_PRIO;
+	}
+	if(prio > NR_PRIO - 1) {
+		prio = NR_PRIO - 1;
+	}
+	return prio;
+}
+
+void set_nice(struct proc *p, int nice)
+{
+	unsigned int flags;
+	struct prio_array *array;
+
+	SAVE_FLAGS(flags); CLI();
+	if((array = p->array)) {
+		remove_rq(p);
+	}
+	p->nice = nice;
+	p->priority = nice_to_slice(nice);
+	if(p->cpu_count > p->priority) {
+		p->cpu_count = p->priority;
+	}
+	p->prio = effective_prio(p);
+	if(array) {
+		insert_rq(p, array);
+	}
+	need_resched = 1;
+	RESTORE_FLAGS(flags);
+}
+
+/* real-time processes are always kept in the active array */
+void set_scheduler(struct proc *p, int policy, int rt_priority)
+{
+	unsigned int flags;
+	struct prio_array *array;
+
+	SAVE_FLAGS(flags); CLI();
+	if((array = p->array)) {
+		remove_rq(p);
+	}
+	p->policy = policy;
+	p->rt_priority = rt_priority;
+	p->cpu_count = p->priority;
+	p->prio = effective_prio(p);
+	if(array) {
+		insert_rq(p, policy == SCHED_OTHER ? array : active);
+	}
+	need_resched = 1;
+	RESTORE_FLAGS(flags);
+}
+
+/*
+ * A normal process that yields goes to the expired array, so it won't run
+ * again until all other processes have consumed their time slice. A
+ * real-time process goes behind the processes of its same level.
+ */
+void do_sched_yield(void)
+{
+	unsigned int flags;
+
+	SAVE_FLAGS(flags); CLI();
+	if(current->array) {
+		remove_rq(current);
+		insert_rq(current, current->policy == SCHED_OTHER ? expired : active);
+	}
+	need_resched = 1;
+	RESTORE_FLAGS(flags);
+	do_sched();
+}
+
+void dequeue_proc(struct proc *p)
+{
+	unsigned int flags;
+
+	SAVE_FLAGS(flags); CLI();
+	if(p->array) {
+		remove_rq(p);
+	}
+	RESTORE_FLAGS(flags);
+}
+
+/*
+ * Round Robin algorithm within each priority level.
+ *
+ * The level of the current process is recalculated every time it's requeued,
+ * so it follows the variations of its sleep average. Real-time processes
+ * keep their place at the head of their level until they sleep, yield or,
+ * if they are SCHED_RR, consume their quantum.
+ *
+ * A process that consumes its time slice is moved to the expired array with
+ * a new quantum, and when the active array becomes empty both arrays are
+ * swapped. This avoids having to scan all running processes to refill them.
+ */
 void do_sched(void)
 {
-	int count;
-	struct proc *p, *selected;
+	unsigned int flags;
+	struct prio_array *tmp;
+	struct proc *selected;
+	int prio;
 
 	/* let the current running process consume its time slice */
 	if(!need_resched && current->state == PROC_RUNNING && current->cpu_count > 0) {
 		return;
 	}
 
+	SAVE_FLAGS(flags); CLI();
 	need_resched = 0;
-	for(;;) {
-		count = -1;
-		selected = &proc_table[IDLE];
-
-		FOR_EACH_PROCESS_RUNNING(p) {
-			if(p->cpu_count > count) {
-				count = p->cpu_count;
-				selected = p;
+	if(current->state == PROC_RUNNING && current->array == active) {
+		if(current->policy == SCHED_OTHER) {
+			remove_rq(current);
+			current->prio = effective_prio(current);
+			if(current->cpu_count > 0) {
+				/* preempted, goes behind the processes of its level */
+				insert_rq(current, active);
+			} else {
+				current->cpu_count = current->priority;
+				insert_rq(current, expired);
 			}
-			p = p->next_run;
-		}
-		if(count) {
-			break;
-		}
-
-		/* reassigns new quantum to all running processes */
-		FOR_EACH_PROCESS_RUNNING(p) {
-			p->cpu_count = p->priority;
-			p = p->next_run;
+		} else if(current->cpu_count <= 0) {
+			/* SCHED_RR quantum consumed, goes behind its level */
+			remove_rq(current);
+			current->cpu_count = current->priority;
+			insert_rq(current, active);
 		}
 	}
+	if(!active->nr_procs) {
+		tmp = active;
+		active = expired;
+		expired = tmp;
+	}
+	if((prio = first_prio(active)) < 0) {
+		selected = &proc_table[IDLE];
+	} else {
+		selected = active->head[prio];
+	}
+	RESTORE_FLAGS(flags);
+
 	if(current != selected) {
 		context_switch(selected);
 	}
@@ -39,6 +39,11 @@ int send_sig(struct proc *p, __sigset_t signum)
 		return 0;
 	}
 
+	/* neither the exiting processes, which have no signal handlers */
+	if(!p->sighand) {
+		return 0;
+	}
+
 	switch(signum) {
 		case 0:
 			return 0;
@@ -72,13 +77,13 @@ int send_sig(struct proc *p, __sigset_t signum)
 	switch(signum) {
 		case SIGFPE:
 		case SIGSEGV:
-			if(p->sigaction[signum - 1].sa_handler == SIG_IGN) {
-				p->sigaction[signum - 1].sa_handler = SIG_DFL;
+			if(p->sighand->action[signum - 1].sa_handler == SIG_IGN) {
+				p->sighand->action[signum - 1].sa_handler = SIG_DFL;
 			}
 			break;
 	}
 
-	if(p->sigaction[signum - 1].sa_handler == SIG_DFL) {
+	if(p->sighand->action[signum - 1].sa_handler == SIG_DFL) {
 		/*
 		 * INIT process is special, it only gets signals that have the
 		 * signal handler installed. This avoids to bring down the
@@ -94,7 +99,7 @@ int send_sig(struct proc *p, __sigset_t signum)
 		}
 	}
 
-	if(p->sigaction[signum - 1].sa_handler == SIG_IGN) {
+	if(p->sighand->action[signum - 1].sa_handler == SIG_IGN) {
 		/* if SIGCHLD is ignored reap its children (prevent zombies) */
 		if(signum == SIGCHLD) {
 			while(sys_waitpid(-1, NULL, WNOHANG) > 0) {
@@ -128,18 +133,18 @@ int issig(void)
 	for(signum = 1, mask = 1; signum < NSIG; signum++, mask <<= 1) {
 		if(current->sigpending & mask) {
 			if(signum == SIGCHLD) {
-				if(current->sigaction[signum - 1].sa_handler == SIG_IGN) {
+				if(current->sighand->action[signum - 1].sa_handler == SIG_IGN) {
 					/* this process ignores SIGCHLD */
 					while((p = get_next_zombie(current))) {
 						remove_zombie(p);
 					}
 				} else {
-					if(current->sigaction[signum - 1].sa_handler != SIG_DFL) {
+					if(current->sighand->action[signum - 1].sa_handler != SIG_DFL) {
 						return signum;
 					}
 				}
 			} else {
-				if(current->sigaction[signum - 1].sa_handler != SIG_IGN) {
+				if(current->sighand->action[signum - 1].sa_handler != SIG_IGN) {
 					return signum;
 				}
 			}
@@ -162,7 +167,7 @@ void psig(unsigned int stack)
 		if(current->sigpending & mask) {
 			current->sigpending &= ~mask;
 
-			if((unsigned int)current->sigaction[signum - 1].sa_handler) {
+			if((unsigned int)current->sighand->action[signum - 1].sa_handler) {
 
 				/*
 				 * page_not_present() may have raised a SIGSEGV if it
@@ -179,7 +184,7 @@ void psig(unsigned int stack)
 				}
 
 				current->sigexecuting = mask;
-				if(!(current->sigaction[signum - 1].sa_flags & SA_NODEFER)) {
+				if(!(current->sighand->action[signum - 1].sa_flags & SA_NODEFER)) {
 					current->sigblocked |= mask;
 				}
 
@@ -191,16 +196,16 @@ void psig(unsigned int stack)
 				sc->oldesp -= 4;
 				sc->oldesp &= ~3;	/* round up */
 				memcpy_b((void *)sc->oldesp, sighandler_trampoline, len);
-				sc->ecx = (unsigned int)current->sigaction[signum - 1].sa_handler;
+				sc->ecx = (unsigned int)current->sighand->action[signum - 1].sa_handler;
 				sc->eax= signum;
 				sc->eip = sc->oldesp;
 
-				if(current->sigaction[signum - 1].sa_flags & SA_RESETHAND) {
-					current->sigaction[signum - 1].sa_handler = SIG_DFL;
+				if(current->sighand->action[signum - 1].sa_flags & SA_RESETHAND) {
+					current->sighand->action[signum - 1].sa_handler = SIG_DFL;
 				}
 				return;
 			}
-			if(current->sigaction[signum - 1].sa_handler == SIG_DFL) {
+			if(current->sighand->action[signum - 1].sa_handler == SIG_DFL) {
 				switch(signum) {
 					case SIGCONT:
 						runnable(current);
@@ -212,7 +217,7 @@ void psig(unsigned int stack)
 					case SIGTTOU:
 						current->exit_code = signum;
 						not_runnable(current, PROC_STOPPED);
-						if(!(current->sigaction[signum - 1].sa_flags & SA_NOCLDSTOP)) {
+						if(!(current->sighand->action[signum - 1].sa_flags & SA_NOCLDSTOP)) {
 							p = current->ppid;
 							send_sig(p, SIGCHLD);
 							/* needed for job control */
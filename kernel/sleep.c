@@ -10,6 +10,7 @@
 #include <fiwix/limits.h>
 #include <fiwix/sleep.h>
 #include <fiwix/sched.h>
+#include <fiwix/timer.h>
 #include <fiwix/signal.h>
 #include <fiwix/process.h>
 #include <fiwix/stdio.h>
@@ -22,6 +23,22 @@ struct proc *sleep_hash_table[NR_BUCKETS];
 struct proc *proc_run_head;
 static unsigned int area = 0;
 
+/* credits the time slept to the interactivity bonus of the process */
+static void add_sleep_avg(struct proc *p)
+{
+	unsigned int slept;
+
+	slept = CURRENT_TICKS - p->sleep_start;
+	if(slept > MAX_SLEEP_AVG) {
+		slept = MAX_SLEEP_AVG;
+	}
+	p->sleep_avg += slept;
+	if(p->sleep_avg > MAX_SLEEP_AVG) {
+		p->sleep_avg = MAX_SLEEP_AVG;
+	}
+	p->prio = effective_prio(p);
+}
+
 void runnable(struct proc *p)
 {
 	unsigned int flags;
@@ -38,6 +55,7 @@ void runnable(struct proc *p)
 	}
 	proc_run_head = p;
 	p->state = PROC_RUNNING;
+	enqueue_proc(p);
 	RESTORE_FLAGS(flags);
 }
 
@@ -57,6 +75,7 @@ void not_runnable(struct proc *p, int state)
 	}
 	p->prev_run = p->next_run = NULL;
 	p->state = state;
+	dequeue_proc(p);
 	RESTORE_FLAGS(flags);
 }
 
@@ -99,6 +118,7 @@ int sleep(void *address, int state)
 	if(state == PROC_UNINTERRUPTIBLE) {
 		current->flags |= PF_NOTINTERRUPT;
 	}
+	current->sleep_start = CURRENT_TICKS;
 	not_runnable(current, PROC_SLEEPING);
 
 	do_sched();
@@ -127,6 +147,7 @@ void wakeup(void *address)
 			(*h)->sleep_address = NULL;
 			(*h)->cpu_count = (*h)->priority;
 			(*h)->flags &= ~PF_NOTINTERRUPT;
+			add_sleep_avg(*h);
 			runnable(*h);
 			need_resched = 1;
 			if((*h)->next_sleep) {
@@ -182,6 +203,9 @@ void wakeup_proc(struct proc *p)
 	}
 	p->sleep_address = NULL;
 	p->cpu_count = p->priority;
+	if(p->state == PROC_SLEEPING) {
+		add_sleep_avg(p);
+	}
 	runnable(p);
 	need_resched = 1;
 
@@ -31,7 +31,7 @@ static int verify_address(int type, const void *addr, unsigned int size)
 	 * calls sys_open() and sys_execve() from init_trampoline(),
 	 * but these calls are trusted.
 	 */
-	if(!current->vma_table) {
+	if(!current->mm->vma_table) {
 		return 0;
 	}
 
@@ -43,7 +43,7 @@ static int verify_address(int type, const void *addr, unsigned int size)
 		 * and let 'do_page_fault()' to handle the imminent page
 		 * fault as soon as the kernel will try to access it.
 		 */
-		vma = current->vma_table->prev;
+		vma = current->mm->vma_table->prev;
 		if(vma) {
 			if(vma->s_type == P_STACK) {
 				if(start < vma->start && start > vma->prev->end) {
@@ -226,7 +226,7 @@ void *syscall_table[] = {
 	NULL,					/* sys_stty (-ENOSYS) */
 	NULL,					/* sys_gtty (-ENOSYS) */
 	sys_access,
-	NULL,	/* sys_nice */
+	sys_nice,
 	sys_ftime,			/* 35 */
 	sys_sync,
 	sys_kill,
@@ -279,7 +279,7 @@ void *syscall_table[] = {
 	sys_lstat,
 	sys_readlink,			/* 85 */
 	NULL,	/* sys_uselib */
-	NULL,	/* sys_swapon */
+	sys_swapon,
 	sys_reboot,
 	NULL,	/* old_readdir */
 	old_mmap,			/* 90 */
@@ -288,8 +288,8 @@ void *syscall_table[] = {
 	sys_ftruncate,
 	sys_fchmod,
 	sys_fchown,			/* 95 */
-	NULL,	/* sys_getpriority */
-	NULL,	/* sys_setpriority */
+	sys_getpriority,
+	sys_setpriority,
 	NULL,					/* sys_profil (-ENOSYS) */
 	sys_statfs,
 	sys_fstatfs,			/* 100 */
@@ -307,7 +307,7 @@ void *syscall_table[] = {
 	NULL,					/* sys_idle (-ENOSYS) */
 	NULL,	/* sys_vm86old */
 	sys_wait4,
-	NULL,	/* sys_swapoff */	/* 115 */
+	sys_swapoff,			/* 115 */
 	sys_sysinfo,
 #ifdef CONFIG_SYSVIPC
 	sys_ipc,
@@ -316,7 +316,7 @@ void *syscall_table[] = {
 #endif /* CONFIG_SYSVIPC */
 	sys_fsync,
 	sys_sigreturn,
-	NULL,	/* sys_clone */		/* 120 */
+	sys_clone,			/* 120 */
 	sys_setdomainname,
 	sys_newuname,
 	NULL,	/* sys_modify_ldt */
@@ -340,7 +340,7 @@ void *syscall_table[] = {
 	sys_getdents,
 	sys_select,
 	sys_flock,
-	NULL,	/* sys_msync */
+	sys_msync,
 	sys_readv,			/* 145 */
 	sys_writev,
 	sys_getsid,
@@ -350,16 +350,16 @@ void *syscall_table[] = {
 	NULL,	/* sys_munlock */
 	NULL,	/* sys_mlockall */
 	NULL,	/* sys_munlockall */
-	NULL,	/* sys_sched_setparam */
-	NULL,	/* sys_sched_getparam */	/* 155 */
-	NULL,	/* sys_sched_setscheduler */
-	NULL,	/* sys_sched_getscheduler */
-	NULL,	/* sys_sched_yield */
-	NULL,	/* sys_sched_get_priority_max */
-	NULL,	/* sys_sched_get_priority_min */	/* 160 */
-	NULL,	/* sys_sched_rr_get_interval */
+	sys_sched_setparam,
+	sys_sched_getparam,		/* 155 */
+	sys_sched_setscheduler,
+	sys_sched_getscheduler,
+	sys_sched_yield,
+	sys_sched_get_priority_max,
+	sys_sched_get_priority_min,	/* 160 */
+	sys_sched_rr_get_interval,
 	sys_nanosleep,
-	NULL,	/* sys_mremap */
+	sys_mremap,
 	NULL,
 	NULL,				/* 165 */
 	NULL,
@@ -386,7 +386,7 @@ void *syscall_table[] = {
 	NULL,
 	NULL,
 	NULL,
-	sys_fork,			/* 190 (sys_vfork) */
+	sys_vfork,			/* 190 */
 	NULL,
 #ifdef CONFIG_MMAP2
 	sys_mmap2,
@@ -419,7 +419,7 @@ void *syscall_table[] = {
 	NULL,
 	NULL,
 	NULL,
-	NULL,
+	sys_madvise,
 	sys_getdents64,			/* 220 */
 	sys_fcntl64,
 	NULL,
@@ -450,7 +450,7 @@ void *syscall_table[] = {
 	NULL,
 	NULL,
 	NULL,
-	NULL,				/* 250 */
+	sys_fadvise64,			/* 250 */
 	NULL,
 	NULL,
 	NULL,
@@ -22,36 +22,34 @@ int sys_brk(unsigned int brk)
 	printk("(pid %d) sys_brk(0x%08x) -> ", current->pid, brk);
 #endif /*__DEBUG__ */
 
-	if(!brk || brk < current->brk_lower) {
+	if(!brk || brk < current->mm->brk_lower) {
 #ifdef __DEBUG__
-		printk("0x%08x\n", current->brk);
+		printk("0x%08x\n", current->mm->brk);
 #endif /*__DEBUG__ */
-		return current->brk;
+		return current->mm->brk;
 	}
 
 	newbrk = PAGE_ALIGN(brk);
-	if(newbrk == current->brk || newbrk < current->brk_lower) {
+	if(newbrk == current->mm->brk || newbrk < current->mm->brk_lower) {
 #ifdef __DEBUG__
-		printk("0x%08x\n", current->brk);
+		printk("0x%08x\n", current->mm->brk);
 #endif /*__DEBUG__ */
 		return brk;
 	}
 
-	if(brk < current->brk) {
-		do_munmap(newbrk, current->brk - newbrk);
-		current->brk = brk;
-#ifdef __DEBUG__
-		printk("0x%08x\n", current->brk);
-#endif /*__DEBUG__ */
-		return current->brk;
-	}
-	if(!expand_heap(newbrk)) {
-		current->brk = brk;
+	lock_mm(current->mm);
+	if(brk < current->mm->brk) {
+		do_munmap(newbrk, current->mm->brk - newbrk);
+		current->mm->brk = brk;
+	} else if(!expand_heap(newbrk)) {
+		current->mm->brk = brk;
 	} else {
+		unlock_mm(current->mm);
 		return -ENOMEM;
 	}
+	unlock_mm(current->mm);
 #ifdef __DEBUG__
-	printk("0x%08x\n", current->brk);
+	printk("0x%08x\n", current->mm->brk);
 #endif /*__DEBUG__ */
-	return current->brk;
+	return current->mm->brk;
 }
@@ -42,8 +42,8 @@ int sys_chdir(const char *dirname)
 		free_name(tmp_name);
 		return errno;
 	}
-	iput(current->pwd);
-	current->pwd = i;
+	iput(current->fs->pwd);
+	current->fs->pwd = i;
 	free_name(tmp_name);
 	return 0;
 }
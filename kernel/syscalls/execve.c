@@ -360,7 +360,7 @@ int sys_execve(const char *filename, char *argv[], char *envp[], int arg4, int a
 
 	strncpy(current->argv0, tmp_name, NAME_MAX);
 	for(n = 0; n < OPEN_MAX; n++) {
-		if(current->fd[n] && (current->fd_flags[n] & FD_CLOEXEC)) {
+		if(current->files->fd[n] && (current->files->fd_flags[n] & FD_CLOEXEC)) {
 			sys_close(n);
 		}
 	}
@@ -370,10 +370,10 @@ int sys_execve(const char *filename, char *argv[], char *envp[], int arg4, int a
 	current->sigpending = 0;
 	current->sigexecuting = 0;
 	for(n = 0; n < NSIG; n++) {
-		current->sigaction[n].sa_mask = 0;
-		current->sigaction[n].sa_flags = 0;
-		if(current->sigaction[n].sa_handler != SIG_IGN) {
-			current->sigaction[n].sa_handler = SIG_DFL;
+		current->sighand->action[n].sa_mask = 0;
+		current->sighand->action[n].sa_flags = 0;
+		if(current->sighand->action[n].sa_handler != SIG_IGN) {
+			current->sighand->action[n].sa_handler = SIG_DFL;
 		}
 	}
 	current->sleep_address = NULL;
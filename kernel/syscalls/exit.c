@@ -9,6 +9,7 @@
 #include <fiwix/kernel.h>
 #include <fiwix/syscalls.h>
 #include <fiwix/process.h>
+#include <fiwix/timer.h>
 #include <fiwix/sched.h>
 #include <fiwix/mman.h>
 #include <fiwix/sleep.h>
@@ -22,7 +23,6 @@
 
 void do_exit(int exit_code)
 {
-	int n;
 	struct proc *p, *init;
 
 #ifdef __DEBUG__
@@ -37,6 +37,7 @@ void do_exit(int exit_code)
 	}
 #endif /* CONFIG_SYSVIPC */
 
+	del_proc_callouts(current);
 	release_binary();
 	current->argv = NULL;
 	current->envp = NULL;
@@ -72,16 +73,8 @@ void do_exit(int exit_code)
 		disassociate_ctty(current->ctty);
 	}
 
-	for(n = 0; n < OPEN_MAX; n++) {
-		if(current->fd[n]) {
-			sys_close(n);
-		}
-	}
-
-	iput(current->root);
-	current->root = NULL;
-	iput(current->pwd);
-	current->pwd = NULL;
+	exit_files();
+	exit_fs();
 	current->exit_code = exit_code;
 	if(!--nr_processes) {
 		printk("\n");
@@ -102,11 +95,7 @@ void do_exit(int exit_code)
 	current->sigpending = 0;
 	current->sigblocked = 0;
 	current->sigexecuting = 0;
-	for(n = 0; n < NSIG; n++) {
-		current->sigaction[n].sa_mask = 0;
-		current->sigaction[n].sa_flags = 0;
-		current->sigaction[n].sa_handler = SIG_IGN;
-	}
+	exit_sighand();
 
 	not_runnable(current, PROC_ZOMBIE);
 	need_resched = 1;
@@ -0,0 +1,73 @@
+/*
+ * fiwix/kernel/syscalls/fadvise64.c
+ *
+ * Copyright 2024, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#include <fiwix/types.h>
+#include <fiwix/fs.h>
+#include <fiwix/mm.h>
+#include <fiwix/fcntl.h>
+#include <fiwix/stat.h>
+#include <fiwix/errno.h>
+
+#ifdef __DEBUG__
+#include <fiwix/stdio.h>
+#include <fiwix/process.h>
+#endif /*__DEBUG__ */
+
+int sys_fadvise64(unsigned int ufd, __loff_t offset, __size_t len, int advice)
+{
+	struct inode *i;
+	__off_t start, end;
+
+#ifdef __DEBUG__
+	printk("(pid %d) sys_fadvise64(%d, %llu, %d, %d)\n", current->pid, ufd, offset, len, advice);
+#endif /*__DEBUG__ */
+
+	CHECK_UFD(ufd);
+	i = fd_table[current->files->fd[ufd]].inode;
+	if(S_ISFIFO(i->i_mode) || S_ISSOCK(i->i_mode)) {
+		return -ESPIPE;
+	}
+	if(offset < 0) {
+		return -EINVAL;
+	}
+
+	/* the range is limited by the file size, a zero length means until EOF */
+	start = end = i->i_size;
+	if(offset < i->i_size) {
+		start = (__off_t)offset;
+		if(len && offset + len < i->i_size) {
+			end = (__off_t)(offset + len);
+		}
+	}
+
+	switch(advice) {
+		case POSIX_FADV_NORMAL:
+		case POSIX_FADV_RANDOM:
+		case POSIX_FADV_SEQUENTIAL:
+		case POSIX_FADV_NOREUSE:
+			fd_table[current->files->fd[ufd]].advice = advice;
+			break;
+		case POSIX_FADV_WILLNEED:
+			if(S_ISREG(i->i_mode) && start < end) {
+				start &= PAGE_MASK;
+				page_readahead(i, start, (PAGE_ALIGN(end) - start) / PAGE_SIZE);
+			}
+			break;
+		case POSIX_FADV_DONTNEED:
+			/* only the pages entirely covered by the range */
+			if(S_ISREG(i->i_mode)) {
+				if(end < i->i_size) {
+					end &= PAGE_MASK;
+				}
+				drop_inode_pages(i, PAGE_ALIGN(start), PAGE_ALIGN(end));
+			}
+			break;
+		default:
+			return -EINVAL;
+	}
+	return 0;
+}
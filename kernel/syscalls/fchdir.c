@@ -23,12 +23,12 @@ int sys_fchdir(unsigned int ufd)
 #endif /*__DEBUG__ */
 
 	CHECK_UFD(ufd);
-	i = fd_table[current->fd[ufd]].inode;
+	i = fd_table[current->files->fd[ufd]].inode;
 	if(!S_ISDIR(i->i_mode)) {
 		return -ENOTDIR;
 	}
-	iput(current->pwd);
-	current->pwd = i;
-	current->pwd->count++;
+	iput(current->fs->pwd);
+	current->fs->pwd = i;
+	current->fs->pwd->count++;
 	return 0;
 }
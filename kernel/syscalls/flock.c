@@ -23,6 +23,6 @@ int sys_flock(unsigned int ufd, int op)
 #endif /*__DEBUG__ */
 
 	CHECK_UFD(ufd);
-	i = fd_table[current->fd[ufd]].inode;
+	i = fd_table[current->files->fd[ufd]].inode;
 	return flock_inode(i, op);
 }
@@ -14,39 +14,37 @@
 #include <fiwix/sched.h>
 #include <fiwix/sleep.h>
 #include <fiwix/mm.h>
+#include <fiwix/mman.h>
 #include <fiwix/errno.h>
 #include <fiwix/stdio.h>
 #include <fiwix/string.h>
 
-static void free_vma_table(struct proc *p)
+static void free_vma_table(struct mm *mm)
 {
 	struct vma *vma, *tmp;
 
-	vma = p->vma_table;
+	vma = mm->vma_table;
 	while(vma) {
 		tmp = vma;
 		vma = vma->next;
-		kfree((unsigned int)tmp);
+		slab_free(vma_cache, tmp);
 	}
 }
 
-#ifdef CONFIG_SYSCALL_6TH_ARG
-int sys_fork(int arg1, int arg2, int arg3, int arg4, int arg5, int arg6, struct sigcontext *sc)
-#else
-int sys_fork(int arg1, int arg2, int arg3, int arg4, int arg5, struct sigcontext *sc)
-#endif /* CONFIG_SYSCALL_6TH_ARG */
+static int do_fork(unsigned int clone_flags, unsigned int newsp, struct sigcontext *sc)
 {
 	int count, pages;
-	unsigned int n;
 	unsigned int *child_pgdir;
 	struct sigcontext *stack;
 	struct proc *child, *p;
 	struct vma *vma, *child_vma;
+	struct page *pg;
 	__pid_t pid;
 
-#ifdef __DEBUG__
-	printk("(pid %d) sys_fork()\n", current->pid);
-#endif /*__DEBUG__ */
+	/* the signal handlers can only be shared along with the handlers' code */
+	if((clone_flags & CLONE_SIGHAND) && !(clone_flags & CLONE_VM)) {
+		return -EINVAL;
+	}
 
 	/* check the number of processes already allocated by this UID */
 	count = 0;
@@ -78,12 +76,52 @@ int sys_fork(int arg1, int arg2, int arg3, int arg4, int arg5, struct sigcontext
 	child->pid = pid;
 	sprintk(child->pidstr, "%d", child->pid);
 
-	if(!(child_pgdir = (void *)kmalloc(PAGE_SIZE))) {
+	/* the tables are either shared with the parent or copied */
+	if(clone_flags & CLONE_FILES) {
+		child->files->count++;
+	} else {
+		child->files = copy_files(current->files);
+	}
+	if(clone_flags & CLONE_FS) {
+		child->fs->count++;
+	} else {
+		child->fs = copy_fs(current->fs);
+	}
+	if(clone_flags & CLONE_SIGHAND) {
+		child->sighand->count++;
+	} else {
+		child->sighand = copy_sighand(current->sighand);
+	}
+	if(!child->files || !child->fs || !child->sighand) {
+		release_tables(child);
 		release_proc(child);
 		return -ENOMEM;
 	}
-	child->rss++;
-	memcpy_b(child_pgdir, kpage_dir, PAGE_SIZE);
+
+	if(clone_flags & CLONE_VM) {
+		/* the page directory counter tracks the sharing processes */
+		child_pgdir = (unsigned int *)P2V(current->tss.cr3);
+		pg = &page_table[current->tss.cr3 >> PAGE_SHIFT];
+		pg->count++;
+		child->mm->count++;
+		child->mm->users++;
+	} else {
+		if(!(child->mm = alloc_mm())) {
+			release_tables(child);
+			release_proc(child);
+			return -ENOMEM;
+		}
+		if(!(child_pgdir = (void *)kmalloc(PAGE_SIZE))) {
+			put_mm(child->mm);
+			release_tables(child);
+			release_proc(child);
+			return -ENOMEM;
+		}
+		child->mm->rss++;
+		child->mm->brk_lower = current->mm->brk_lower;
+		child->mm->brk = current->mm->brk;
+		copy_page(child_pgdir, kpage_dir);
+	}
 	child->tss.cr3 = V2P((unsigned int)child_pgdir);
 
 	child->ppid = current;
@@ -92,30 +130,33 @@ int sys_fork(int arg1, int arg2, int arg3, int arg4, int arg5, struct sigcontext
 	child->cpu_count = child->priority;
 	child->start_time = CURRENT_TICKS;
 	child->sleep_address = NULL;
+	child->timeout = 0;
+	if(clone_flags & CLONE_VFORK) {
+		child->flags |= PF_VFORK;
+	}
 
-	vma = current->vma_table;
-	child->vma_table = NULL;
-	while(vma) {
-		if(!(child_vma = (struct vma *)kmalloc(sizeof(struct vma)))) {
-			kfree((unsigned int)child_pgdir);
-			free_vma_table(child);
-			release_proc(child);
-			return -ENOMEM;
+	vma = current->mm->vma_table;
+	while(vma && !(clone_flags & CLONE_VM)) {
+		if(!(child_vma = (struct vma *)slab_alloc(vma_cache))) {
+			goto do_fork__nomem;
 		}
 		*child_vma = *vma;
 		child_vma->prev = child_vma->next = NULL;
 		if(child_vma->inode) {
 			child_vma->inode->count++;
 		}
-		if(!child->vma_table) {
-			child->vma_table = child_vma;
+		if(!child->mm->vma_table) {
+			child->mm->vma_table = child_vma;
 		} else {
-			child_vma->prev = child->vma_table->prev;
-			child->vma_table->prev->next = child_vma;
+			child_vma->prev = child->mm->vma_table->prev;
+			child->mm->vma_table->prev->next = child_vma;
 		}
-		child->vma_table->prev = child_vma;
+		child->mm->vma_table->prev = child_vma;
 		vma = vma->next;
 	}
+	if(!(clone_flags & CLONE_VM)) {
+		build_vma_tree(child);
+	}
 
 	child->sigpending = 0;
 	child->sigexecuting = 0;
@@ -123,7 +164,6 @@ int sys_fork(int arg1, int arg2, int arg3, int arg4, int arg5, struct sigcontext
 	memset_b(&child->usage, 0, sizeof(struct rusage));
 	memset_b(&child->cusage, 0, sizeof(struct rusage));
 	child->it_real_interval = 0;
-	child->it_real_value = 0;
 	child->it_virt_interval = 0;
 	child->it_virt_value = 0;
 	child->it_prof_interval = 0;
@@ -134,45 +174,32 @@ int sys_fork(int arg1, int arg2, int arg3, int arg4, int arg5, struct sigcontext
 
 
 	if(!(child->tss.esp0 = kmalloc(PAGE_SIZE))) {
-		kfree((unsigned int)child_pgdir);
-		free_vma_table(child);
-		release_proc(child);
-		return -ENOMEM;
+		goto do_fork__nomem;
 	}
 
-	if(!(pages = clone_pages(child))) {
-		printk("WARNING: %s(): not enough memory when cloning pages.\n", __FUNCTION__);
-		free_page_tables(child);
-		kfree((unsigned int)child_pgdir);
-		free_vma_table(child);
-		release_proc(child);
-		return -ENOMEM;
+	if(!(clone_flags & CLONE_VM)) {
+		if(!(pages = clone_pages(child))) {
+			printk("WARNING: %s(): not enough memory when cloning pages.\n", __FUNCTION__);
+			kfree(child->tss.esp0);
+			free_page_tables(child);
+			goto do_fork__nomem;
+		}
+		child->mm->rss += pages;
+		invalidate_tlb();
 	}
-	child->rss += pages;
-	invalidate_tlb();
 
 	child->tss.esp0 += PAGE_SIZE - 4;
-	child->rss++;
+	child->mm->rss++;
 	child->tss.ss0 = KERNEL_DS;
 
-	memcpy_b((unsigned int *)(child->tss.esp0 & PAGE_MASK), (void *)((unsigned int)(sc) & PAGE_MASK), PAGE_SIZE);
+	copy_page((unsigned int *)(child->tss.esp0 & PAGE_MASK), (void *)((unsigned int)(sc) & PAGE_MASK));
 	stack = (struct sigcontext *)((child->tss.esp0 & PAGE_MASK) + ((unsigned int)(sc) & ~PAGE_MASK));
 
 	child->tss.eip = (unsigned int)return_from_syscall;
 	child->tss.esp = (unsigned int)stack;
 	stack->eax = 0;		/* child returns 0 */
-
-	/* increase file descriptors usage */
-	for(n = 0; n < OPEN_MAX; n++) {
-		if(current->fd[n]) {
-			fd_table[current->fd[n]].count++;
-		}
-	}
-	if(current->root) {
-		current->root->count++;
-	}
-	if(current->pwd) {
-		current->pwd->count++;
+	if(newsp) {
+		stack->oldesp = newsp;
 	}
 
 	kstat.processes++;
@@ -180,5 +207,62 @@ int sys_fork(int arg1, int arg2, int arg3, int arg4, int arg5, struct sigcontext
 	current->children++;
 	runnable(child);
 
-	return child->pid;	/* parent returns child's PID */
+	/* the parent sleeps until the child calls execve() or exits */
+	pid = child->pid;
+	while(child->flags & PF_VFORK) {
+		sleep(child, PROC_UNINTERRUPTIBLE);
+	}
+
+	return pid;	/* parent returns child's PID */
+
+do_fork__nomem:
+	if(clone_flags & CLONE_VM) {
+		child->mm->users--;
+	} else {
+		free_vma_table(child->mm);
+	}
+	kfree((unsigned int)child_pgdir);
+	put_mm(child->mm);
+	release_tables(child);
+	release_proc(child);
+	return -ENOMEM;
+}
+
+#ifdef CONFIG_SYSCALL_6TH_ARG
+int sys_fork(int arg1, int arg2, int arg3, int arg4, int arg5, int arg6, struct sigcontext *sc)
+#else
+int sys_fork(int arg1, int arg2, int arg3, int arg4, int arg5, struct sigcontext *sc)
+#endif /* CONFIG_SYSCALL_6TH_ARG */
+{
+#ifdef __DEBUG__
+	printk("(pid %d) sys_fork()\n", current->pid);
+#endif /*__DEBUG__ */
+
+	return do_fork(0, 0, sc);
+}
+
+#ifdef CONFIG_SYSCALL_6TH_ARG
+int sys_vfork(int arg1, int arg2, int arg3, int arg4, int arg5, int arg6, struct sigcontext *sc)
+#else
+int sys_vfork(int arg1, int arg2, int arg3, int arg4, int arg5, struct sigcontext *sc)
+#endif /* CONFIG_SYSCALL_6TH_ARG */
+{
+#ifdef __DEBUG__
+	printk("(pid %d) sys_vfork()\n", current->pid);
+#endif /*__DEBUG__ */
+
+	return do_fork(CLONE_VM | CLONE_VFORK, 0, sc);
+}
+
+#ifdef CONFIG_SYSCALL_6TH_ARG
+int sys_clone(unsigned int flags, unsigned int newsp, int arg3, int arg4, int arg5, int arg6, struct sigcontext *sc)
+#else
+int sys_clone(unsigned int flags, unsigned int newsp, int arg3, int arg4, int arg5, struct sigcontext *sc)
+#endif /* CONFIG_SYSCALL_6TH_ARG */
+{
+#ifdef __DEBUG__
+	printk("(pid %d) sys_clone(0x%x, 0x%x)\n", current->pid, flags, newsp);
+#endif /*__DEBUG__ */
+
+	return do_fork(flags & ~CSIGNAL, newsp, sc);
 }
@@ -26,8 +26,8 @@ int sys_ftruncate(unsigned int ufd, __off_t length)
 #endif /*__DEBUG__ */
 
 	CHECK_UFD(ufd);
-	i = fd_table[current->fd[ufd]].inode;
-	if((fd_table[current->fd[ufd]].flags & O_ACCMODE) == O_RDONLY) {
+	i = fd_table[current->files->fd[ufd]].inode;
+	if((fd_table[current->files->fd[ufd]].flags & O_ACCMODE) == O_RDONLY) {
 		return -EINVAL;
 	}
 	if(S_ISDIR(i->i_mode)) {
@@ -47,12 +47,12 @@ int sys_getcwd(char *buf, __size_t size)
 		return -ERANGE;
 	}
 
-	cur = current->pwd;
+	cur = current->fs->pwd;
 	up = cur;
 	marker = size - 2;	/* reserve '\0' at the end */
 	buf[size - 1] = 0;
 
-	if(cur == current->root) {
+	if(cur == current->fs->root) {
 		/* this case needs special handling, otherwise the loop skips over root */
 		buf[0] = '/';
 		buf[1] = '\0';
@@ -64,7 +64,7 @@ int sys_getcwd(char *buf, __size_t size)
 
 	do {
 		if((errno = parse_namei("..", cur, &up, 0, FOLLOW_LINKS))) {
-			if(cur != current->pwd) {
+			if(cur != current->fs->pwd) {
 				iput(cur);
 			}
 			kfree((unsigned int)dirent_buf);
@@ -72,7 +72,7 @@ int sys_getcwd(char *buf, __size_t size)
 		}
 		if((tmp_fd = get_new_fd(up)) < 0) {
 			iput(up);
-			if(cur != current->pwd) {
+			if(cur != current->fs->pwd) {
 				iput(cur);
 			}
 			kfree((unsigned int)dirent_buf);
@@ -84,7 +84,7 @@ int sys_getcwd(char *buf, __size_t size)
 			if(bytes_read < 0) {
 				release_fd(tmp_fd);
 				iput(up);
-				if(cur != current->pwd) {
+				if(cur != current->fs->pwd) {
 					iput(cur);
 				}
 				kfree((unsigned int)dirent_buf);
@@ -109,7 +109,7 @@ int sys_getcwd(char *buf, __size_t size)
 						if(marker < namelength + 1) {
 							release_fd(tmp_fd);
 							iput(up);
-							if(cur != current->pwd) {
+							if(cur != current->fs->pwd) {
 								iput(cur);
 							}
 							if(diff_dev) {
@@ -140,17 +140,17 @@ int sys_getcwd(char *buf, __size_t size)
 		if(!done) {
 			/* parent dir was fully read, child still not found */
 			iput(up);
-			if(cur != current->pwd) {
+			if(cur != current->fs->pwd) {
 				iput(cur);
 			}
 			kfree((unsigned int)dirent_buf);
 			return -ENOENT;
 		}
-		if(cur != current->pwd) {
+		if(cur != current->fs->pwd) {
 			iput(cur);
 		}
 		cur = up;
-	} while(cur != current->root);
+	} while(cur != current->fs->root);
 
 	kfree((unsigned int)dirent_buf);
 	iput(cur);
@@ -28,21 +28,5 @@ int sys_getitimer(int which, struct itimerval *curr_value)
 		}
 	}
 
-	switch(which) {
-		case ITIMER_REAL:
-			ticks2tv(current->it_real_interval, &curr_value->it_interval);
-			ticks2tv(current->it_real_value, &curr_value->it_value);
-			break;
-		case ITIMER_VIRTUAL:
-			ticks2tv(current->it_virt_interval, &curr_value->it_interval);
-			ticks2tv(current->it_virt_value, &curr_value->it_value);
-			break;
-		case ITIMER_PROF:
-			ticks2tv(current->it_prof_interval, &curr_value->it_interval);
-			ticks2tv(current->it_prof_value, &curr_value->it_value);
-			break;
-		default:
-			return -EINVAL;
-	}
-	return 0;
+	return getitimer(which, curr_value);
 }
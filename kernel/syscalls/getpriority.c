@@ -0,0 +1,61 @@
+/*
+ * fiwix/kernel/syscalls/getpriority.c
+ *
+ * Copyright 2024, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#include <fiwix/types.h>
+#include <fiwix/process.h>
+#include <fiwix/sched.h>
+#include <fiwix/errno.h>
+
+#ifdef __DEBUG__
+#include <fiwix/stdio.h>
+#endif /*__DEBUG__ */
+
+/*
+ * As in Linux, the value returned is (20 - nice) to avoid negative numbers
+ * that would be taken as errors. The C library reverts this conversion.
+ */
+int sys_getpriority(int which, int who)
+{
+	struct proc *p;
+	int found, max;
+
+#ifdef __DEBUG__
+	printk("(pid %d) sys_getpriority(%d, %d)\n", current->pid, which, who);
+#endif /*__DEBUG__ */
+
+	if(who < 0) {
+		return -EINVAL;
+	}
+	switch(which) {
+		case PRIO_PROCESS:
+			who = who ? who : current->pid;
+			break;
+		case PRIO_PGRP:
+			who = who ? who : current->pgid;
+			break;
+		case PRIO_USER:
+			who = who ? who : current->uid;
+			break;
+		default:
+			return -EINVAL;
+	}
+
+	found = 0;
+	max = 0;
+	FOR_EACH_PROCESS(p) {
+		if((which == PRIO_PROCESS && p->pid == who) ||
+		   (which == PRIO_PGRP && p->pgid == who) ||
+		   (which == PRIO_USER && p->uid == who)) {
+			found = 1;
+			if(20 - p->nice > max) {
+				max = 20 - p->nice;
+			}
+		}
+		p = p->next;
+	}
+	return found ? max : -ESRCH;
+}
@@ -29,14 +29,14 @@ int sys_llseek(unsigned int ufd, unsigned int offset_high, unsigned int offset_l
 	if((errno = check_user_area(VERIFY_WRITE, result, sizeof(__loff_t)))) {
 		return errno;
 	}
-	i = fd_table[current->fd[ufd]].inode;
+	i = fd_table[current->files->fd[ufd]].inode;
 	offset = (__loff_t)(((__loff_t)offset_high << 32) | offset_low);
 	switch(whence) {
 		case SEEK_SET:
 			new_offset = offset;
 			break;
 		case SEEK_CUR:
-			new_offset = fd_table[current->fd[ufd]].offset + offset;
+			new_offset = fd_table[current->files->fd[ufd]].offset + offset;
 			break;
 		case SEEK_END:
 			new_offset = i->i_size + offset;
@@ -45,7 +45,7 @@ int sys_llseek(unsigned int ufd, unsigned int offset_high, unsigned int offset_l
 			return -EINVAL;
 	}
 	if(i->fsop && i->fsop->llseek) {
-		fd_table[current->fd[ufd]].offset = new_offset;
+		fd_table[current->files->fd[ufd]].offset = new_offset;
 		if((new_offset = i->fsop->llseek(i, new_offset)) < 0) {
 			return (int)new_offset;
 		}
@@ -0,0 +1,48 @@
+/*
+ * fiwix/kernel/syscalls/madvise.c
+ *
+ * Copyright 2024, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#include <fiwix/types.h>
+#include <fiwix/process.h>
+#include <fiwix/mman.h>
+#include <fiwix/mm.h>
+#include <fiwix/errno.h>
+
+#ifdef __DEBUG__
+#include <fiwix/stdio.h>
+#endif /*__DEBUG__ */
+
+int sys_madvise(unsigned int addr, __size_t length, int advice)
+{
+	int errno;
+
+#ifdef __DEBUG__
+	printk("(pid %d) sys_madvise(0x%08x, %d, %d)\n", current->pid, addr, length, advice);
+#endif /*__DEBUG__ */
+
+	if(addr & ~PAGE_MASK) {
+		return -EINVAL;
+	}
+	length = PAGE_ALIGN(length);
+	if((addr + length) < addr) {
+		return -EINVAL;
+	}
+	switch(advice) {
+		case MADV_NORMAL:
+		case MADV_RANDOM:
+		case MADV_SEQUENTIAL:
+		case MADV_WILLNEED:
+		case MADV_DONTNEED:
+			break;
+		default:
+			return -EINVAL;
+	}
+
+	lock_mm(current->mm);
+	errno = do_madvise(addr, length, advice);
+	unlock_mm(current->mm);
+	return errno;
+}
@@ -7,6 +7,7 @@
  */
 
 #include <fiwix/fs.h>
+#include <fiwix/process.h>
 #include <fiwix/mman.h>
 #include <fiwix/mm.h>
 #include <fiwix/fcntl.h>
@@ -15,7 +16,6 @@
 
 #ifdef __DEBUG__
 #include <fiwix/stdio.h>
-#include <fiwix/process.h>
 #endif /*__DEBUG__ */
 
 #ifdef CONFIG_SYSCALL_6TH_ARG
@@ -38,12 +38,14 @@ int sys_mmap2(unsigned int start, unsigned int length, unsigned int prot, unsign
 	flags = 0;
 	if(!(user_flags & MAP_ANONYMOUS)) {
 		CHECK_UFD(fd);
-		if(!(i = fd_table[current->fd[fd]].inode)) {
+		if(!(i = fd_table[current->files->fd[fd]].inode)) {
 			return -EBADF;
 		}
-		flags = fd_table[current->fd[fd]].flags & O_ACCMODE;
+		flags = fd_table[current->files->fd[fd]].flags & O_ACCMODE;
 	}
+	lock_mm(current->mm);
 	page = do_mmap(i, start, length, prot, user_flags, offset*4096, P_MMAP, flags, NULL);
+	unlock_mm(current->mm);
 #ifdef __DEBUG__
 	printk("0x%08x\n", page);
 #endif /*__DEBUG__ */
@@ -6,6 +6,7 @@
  */
 
 #include <fiwix/types.h>
+#include <fiwix/process.h>
 #include <fiwix/mman.h>
 #include <fiwix/mm.h>
 #include <fiwix/fcntl.h>
@@ -13,12 +14,12 @@
 
 #ifdef __DEBUG__
 #include <fiwix/stdio.h>
-#include <fiwix/process.h>
 #endif /*__DEBUG__ */
 
 int sys_mprotect(unsigned int addr, __size_t length, int prot)
 {
 	struct vma *vma;
+	int errno;
 
 #ifdef __DEBUG__
 	printk("(pid %d) sys_mprotect(0x%08x, %d, %d)\n", current->pid, addr, length, prot);
@@ -34,19 +35,15 @@ int sys_mprotect(unsigned int addr, __size_t length, int prot)
 	if((addr + length) < addr) {
 		return -EINVAL;
 	}
-	if(!(vma = find_vma_region(addr))) {
-		return -ENOMEM;
-	}
-	if((addr + length) > vma->end) {
-		return -ENOMEM;
-	}
-	if(vma->inode && (vma->flags & MAP_SHARED)) {
-		if(prot & PROT_WRITE) {
-			if(!(vma->o_mode & (O_WRONLY | O_RDWR))) {
-				return -EACCES;
-			}
-		}
-	}
 
-	return do_mprotect(vma, addr, length, prot);
+	lock_mm(current->mm);
+	if(!(vma = find_vma_region(addr)) || (addr + length) > vma->end) {
+		errno = -ENOMEM;
+	} else if(vma->inode && (vma->flags & MAP_SHARED) && (prot & PROT_WRITE) && !(vma->o_mode & (O_WRONLY | O_RDWR))) {
+		errno = -EACCES;
+	} else {
+		errno = do_mprotect(vma, addr, length, prot);
+	}
+	unlock_mm(current->mm);
+	return errno;
 }
@@ -0,0 +1,58 @@
+/*
+ * fiwix/kernel/syscalls/mremap.c
+ *
+ * Copyright 2024, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#include <fiwix/types.h>
+#include <fiwix/process.h>
+#include <fiwix/mman.h>
+#include <fiwix/mm.h>
+#include <fiwix/errno.h>
+
+#ifdef __DEBUG__
+#include <fiwix/stdio.h>
+#endif /*__DEBUG__ */
+
+int sys_mremap(unsigned int old_address, __size_t old_size, __size_t new_size, int flags, unsigned int new_address)
+{
+	int errno;
+
+#ifdef __DEBUG__
+	printk("(pid %d) sys_mremap(0x%08x, %d, %d, 0x%x, 0x%08x)\n", current->pid, old_address, old_size, new_size, flags, new_address);
+#endif /*__DEBUG__ */
+
+	if(old_address & ~PAGE_MASK) {
+		return -EINVAL;
+	}
+	if(flags & ~(MREMAP_MAYMOVE | MREMAP_FIXED)) {
+		return -EINVAL;
+	}
+	old_size = PAGE_ALIGN(old_size);
+	new_size = PAGE_ALIGN(new_size);
+	if(!old_size || !new_size) {
+		return -EINVAL;
+	}
+	if(old_address + old_size < old_address || old_address + old_size > PAGE_OFFSET) {
+		return -EINVAL;
+	}
+
+	if(flags & MREMAP_FIXED) {
+		if(!(flags & MREMAP_MAYMOVE) || new_address & ~PAGE_MASK) {
+			return -EINVAL;
+		}
+		if(new_address + new_size < new_address || new_address + new_size > PAGE_OFFSET) {
+			return -EINVAL;
+		}
+		/* the old and the new regions can't overlap */
+		if(new_address < old_address + old_size && old_address < new_address + new_size) {
+			return -EINVAL;
+		}
+	}
+
+	lock_mm(current->mm);
+	errno = do_mremap(old_address, old_size, new_size, flags, new_address);
+	unlock_mm(current->mm);
+	return errno;
+}
@@ -0,0 +1,45 @@
+/*
+ * fiwix/kernel/syscalls/msync.c
+ *
+ * Copyright 2024, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#include <fiwix/types.h>
+#include <fiwix/process.h>
+#include <fiwix/mman.h>
+#include <fiwix/mm.h>
+#include <fiwix/errno.h>
+
+#ifdef __DEBUG__
+#include <fiwix/stdio.h>
+#endif /*__DEBUG__ */
+
+int sys_msync(unsigned int addr, __size_t length, int flags)
+{
+	int errno;
+
+#ifdef __DEBUG__
+	printk("(pid %d) sys_msync(0x%08x, %d, 0x%x)\n", current->pid, addr, length, flags);
+#endif /*__DEBUG__ */
+
+	if(addr & ~PAGE_MASK) {
+		return -EINVAL;
+	}
+	if(flags & ~(MS_ASYNC | MS_INVALIDATE | MS_SYNC)) {
+		return -EINVAL;
+	}
+	if((flags & MS_ASYNC) && (flags & MS_SYNC)) {
+		return -EINVAL;
+	}
+	length = PAGE_ALIGN(length);
+	if((addr + length) < addr) {
+		return -ENOMEM;
+	}
+
+	/* the page cache is shared, MS_INVALIDATE has nothing to discard */
+	lock_mm(current->mm);
+	errno = do_msync(addr, length, flags);
+	unlock_mm(current->mm);
+	return errno;
+}
@@ -6,17 +6,22 @@
  */
 
 #include <fiwix/types.h>
+#include <fiwix/process.h>
 #include <fiwix/mman.h>
 
 #ifdef __DEBUG__
 #include <fiwix/stdio.h>
-#include <fiwix/process.h>
 #endif /*__DEBUG__ */
 
 int sys_munmap(unsigned int addr, __size_t length)
 {
+	int errno;
+
 #ifdef __DEBUG__
 	printk("(pid %d) sys_munmap(0x%08x, %d)\n", current->pid, addr, length);
 #endif /*__DEBUG__ */
-	return do_munmap(addr, length);
+	lock_mm(current->mm);
+	errno = do_munmap(addr, length);
+	unlock_mm(current->mm);
+	return errno;
 }
@@ -45,25 +45,26 @@ int sys_nanosleep(const struct timespec *req, struct timespec *rem)
 	}
 
 	/*
-	 * Interrupts must be disabled before setting current->timeout in order
-	 * to avoid a race condition. Otherwise it might occur that timeout is
-	 * so small that it would reach zero before the call to sleep(). In this
-	 * case, the process would miss the wakeup() and would stay in the sleep
-	 * queue forever.
+	 * Arming the timeout might sleep, so it can expire before the call to
+	 * sleep(). In this case the process would miss the wakeup() and would
+	 * stay in the sleep queue forever, so the timeout is checked again with
+	 * the interrupts disabled.
 	 */
 	timeout = (req->tv_sec * HZ) + (nsec * HZ / 1000000000L);
 	if(timeout) {
+		set_timeout(current, timeout);
 		SAVE_FLAGS(flags); CLI();
-		current->timeout = timeout;
-		sleep(&sys_nanosleep, PROC_INTERRUPTIBLE);
-		RESTORE_FLAGS(flags);
 		if(current->timeout) {
+			sleep(&sys_nanosleep, PROC_INTERRUPTIBLE);
+		}
+		RESTORE_FLAGS(flags);
+		if((timeout = del_timeout(current))) {
 			if(rem) {
 				if((errno = check_user_area(VERIFY_WRITE, rem, sizeof(struct timespec)))) {
 					return errno;
 				}
-				rem->tv_sec = current->timeout / HZ;
-				rem->tv_nsec = (current->timeout % HZ) * 1000000000L / HZ;
+				rem->tv_sec = timeout / HZ;
+				rem->tv_nsec = (timeout % HZ) * 1000000000L / HZ;
 			}
 			return -EINTR;
 		}
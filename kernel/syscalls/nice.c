@@ -0,0 +1,45 @@
+/*
+ * fiwix/kernel/syscalls/nice.c
+ *
+ * Copyright 2024, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#include <fiwix/types.h>
+#include <fiwix/process.h>
+#include <fiwix/sched.h>
+#include <fiwix/errno.h>
+
+#ifdef __DEBUG__
+#include <fiwix/stdio.h>
+#endif /*__DEBUG__ */
+
+int sys_nice(int inc)
+{
+	int nice;
+
+#ifdef __DEBUG__
+	printk("(pid %d) sys_nice(%d)\n", current->pid, inc);
+#endif /*__DEBUG__ */
+
+	if(inc < 0 && !IS_SUPERUSER) {
+		return -EPERM;
+	}
+
+	/* avoid overflows with huge increments */
+	if(inc < -(MAX_NICE - MIN_NICE)) {
+		inc = -(MAX_NICE - MIN_NICE);
+	}
+	if(inc > MAX_NICE - MIN_NICE) {
+		inc = MAX_NICE - MIN_NICE;
+	}
+	nice = current->nice + inc;
+	if(nice < MIN_NICE) {
+		nice = MIN_NICE;
+	}
+	if(nice > MAX_NICE) {
+		nice = MAX_NICE;
+	}
+	set_nice(current, nice);
+	return 0;
+}
@@ -6,6 +6,7 @@
  */
 
 #include <fiwix/fs.h>
+#include <fiwix/process.h>
 #include <fiwix/mman.h>
 #include <fiwix/mm.h>
 #include <fiwix/fcntl.h>
@@ -14,7 +15,6 @@
 
 #ifdef __DEBUG__
 #include <fiwix/stdio.h>
-#include <fiwix/process.h>
 #endif /*__DEBUG__ */
 
 int old_mmap(struct mmap *mmap)
@@ -39,12 +39,14 @@ int old_mmap(struct mmap *mmap)
 	flags = 0;
 	if(!(mmap->flags & MAP_ANONYMOUS)) {
 		CHECK_UFD(mmap->fd);
-		if(!(i = fd_table[current->fd[mmap->fd]].inode)) {
+		if(!(i = fd_table[current->files->fd[mmap->fd]].inode)) {
 			return -EBADF;
 		}
-		flags = fd_table[current->fd[mmap->fd]].flags & O_ACCMODE;
+		flags = fd_table[current->files->fd[mmap->fd]].flags & O_ACCMODE;
 	}
+	lock_mm(current->mm);
 	page = do_mmap(i, mmap->start, mmap->length, mmap->prot, mmap->flags, mmap->offset, P_MMAP, flags, NULL);
+	unlock_mm(current->mm);
 #ifdef __DEBUG__
 	printk("0x%08x\n", page);
 #endif /*__DEBUG__ */
@@ -139,7 +139,7 @@ int sys_open(const char *filename, int flags, __mode_t mode)
 #endif /*__DEBUG__ */
 
 	fd_table[fd].flags = flags;
-	current->fd[ufd] = fd;
+	current->files->fd[ufd] = fd;
 	if(i->fsop && i->fsop->open) {
 		if((errno = i->fsop->open(i, &fd_table[fd])) < 0) {
 			release_fd(fd);
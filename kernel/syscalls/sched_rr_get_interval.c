@@ -0,0 +1,44 @@
+/*
+ * fiwix/kernel/syscalls/sched_rr_get_interval.c
+ *
+ * Copyright 2024, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#include <fiwix/types.h>
+#include <fiwix/fs.h>
+#include <fiwix/time.h>
+#include <fiwix/timer.h>
+#include <fiwix/process.h>
+#include <fiwix/sched.h>
+#include <fiwix/errno.h>
+
+#ifdef __DEBUG__
+#include <fiwix/stdio.h>
+#endif /*__DEBUG__ */
+
+int sys_sched_rr_get_interval(__pid_t pid, struct timespec *tp)
+{
+	struct proc *p;
+	int errno, ticks;
+
+#ifdef __DEBUG__
+	printk("(pid %d) sys_sched_rr_get_interval(%d, 0x%08x)\n", current->pid, pid, (unsigned int)tp);
+#endif /*__DEBUG__ */
+
+	if(pid < 0) {
+		return -EINVAL;
+	}
+	if((errno = check_user_area(VERIFY_WRITE, tp, sizeof(struct timespec)))) {
+		return errno;
+	}
+	if(!(p = pid ? get_proc_by_pid(pid) : current)) {
+		return -ESRCH;
+	}
+
+	/* SCHED_FIFO processes have no time slice */
+	ticks = p->policy == SCHED_FIFO ? 0 : p->priority;
+	tp->tv_sec = ticks / HZ;
+	tp->tv_nsec = (ticks % HZ) * (1000000000L / HZ);
+	return 0;
+}
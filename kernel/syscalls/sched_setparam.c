@@ -0,0 +1,55 @@
+/*
+ * fiwix/kernel/syscalls/sched_setparam.c
+ *
+ * Copyright 2024, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#include <fiwix/types.h>
+#include <fiwix/fs.h>
+#include <fiwix/process.h>
+#include <fiwix/sched.h>
+#include <fiwix/errno.h>
+
+#ifdef __DEBUG__
+#include <fiwix/stdio.h>
+#endif /*__DEBUG__ */
+
+int sys_sched_setparam(__pid_t pid, const struct sched_param *param)
+{
+	struct proc *p;
+	int errno;
+
+#ifdef __DEBUG__
+	printk("(pid %d) sys_sched_setparam(%d, 0x%08x)\n", current->pid, pid, (unsigned int)param);
+#endif /*__DEBUG__ */
+
+	if(pid < 0) {
+		return -EINVAL;
+	}
+	if((errno = check_user_area(VERIFY_READ, param, sizeof(struct sched_param)))) {
+		return errno;
+	}
+	if(!(p = pid ? get_proc_by_pid(pid) : current)) {
+		return -ESRCH;
+	}
+	if(p->policy == SCHED_OTHER) {
+		if(param->sched_priority) {
+			return -EINVAL;
+		}
+	} else {
+		if(param->sched_priority < 1 || param->sched_priority > MAX_RT_PRIO - 1) {
+			return -EINVAL;
+		}
+	}
+	if(!IS_SUPERUSER) {
+		if(p->policy != SCHED_OTHER) {
+			return -EPERM;
+		}
+		if(current->euid != p->uid && current->euid != p->euid) {
+			return -EPERM;
+		}
+	}
+	set_scheduler(p, p->policy, param->sched_priority);
+	return 0;
+}
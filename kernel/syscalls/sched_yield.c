@@ -0,0 +1,24 @@
+/*
+ * fiwix/kernel/syscalls/sched_yield.c
+ *
+ * Copyright 2024, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#include <fiwix/types.h>
+#include <fiwix/sched.h>
+
+#ifdef __DEBUG__
+#include <fiwix/stdio.h>
+#include <fiwix/process.h>
+#endif /*__DEBUG__ */
+
+int sys_sched_yield(void)
+{
+#ifdef __DEBUG__
+	printk("(pid %d) sys_sched_yield()\n", current->pid);
+#endif /*__DEBUG__ */
+
+	do_sched_yield();
+	return 0;
+}
@@ -5,6 +5,7 @@
  * Distributed under the terms of the Fiwix License.
  */
 
+#include <fiwix/asm.h>
 #include <fiwix/types.h>
 #include <fiwix/fs.h>
 #include <fiwix/process.h>
@@ -51,15 +52,16 @@ static int do_check(struct inode *i, int flag)
 int do_select(int nfds, fd_set *rfds, fd_set *wfds, fd_set *efds, fd_set *res_rfds, fd_set *res_wfds, fd_set *res_efds)
 {
 	int n, count;
+	unsigned int flags;
 	struct inode *i;
 
 	count = 0;
 	for(;;) {
 		for(n = 0; n < nfds; n++) {
-			if(!current->fd[n]) {
+			if(!current->files->fd[n]) {
 				continue;
 			}
-			i = fd_table[current->fd[n]].inode;
+			i = fd_table[current->files->fd[n]].inode;
 			if(__FD_ISSET(n, rfds)) {
 				if(do_check(i, SEL_R)) {
 					__FD_SET(n, res_rfds);
@@ -80,10 +82,14 @@ int do_select(int nfds, fd_set *rfds, fd_set *wfds, fd_set *efds, fd_set *res_rf
 			}
 		}
 
+		/* the timeout can't expire between the check and the sleep() */
+		SAVE_FLAGS(flags); CLI();
 		if(count || !current->timeout || current->sigpending & ~current->sigblocked) {
+			RESTORE_FLAGS(flags);
 			break;
 		}
 		sleep(&do_select, PROC_INTERRUPTIBLE);
+		RESTORE_FLAGS(flags);
 	}
 
 	return count;
@@ -147,12 +153,12 @@ int sys_select(int nfds, fd_set *readfds, fd_set *writefds, fd_set *exceptfds, s
 	__FD_ZERO(&res_wfds);
 	__FD_ZERO(&res_efds);
 
-	current->timeout = t;
-	if((errno = do_select(nfds, &rfds, &wfds, &efds, &res_rfds, &res_wfds, &res_efds)) < 0) {
+	set_timeout(current, t);
+	errno = do_select(nfds, &rfds, &wfds, &efds, &res_rfds, &res_wfds, &res_efds);
+	t = del_timeout(current);
+	if(errno < 0) {
 		return errno;
 	}
-	t = current->timeout;
-	current->timeout = 0;
 
 	if(readfds) {
 		memcpy_b(readfds, &res_rfds, sizeof(fd_set));
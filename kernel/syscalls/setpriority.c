@@ -0,0 +1,68 @@
+/*
+ * fiwix/kernel/syscalls/setpriority.c
+ *
+ * Copyright 2024, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#include <fiwix/types.h>
+#include <fiwix/process.h>
+#include <fiwix/sched.h>
+#include <fiwix/errno.h>
+
+#ifdef __DEBUG__
+#include <fiwix/stdio.h>
+#endif /*__DEBUG__ */
+
+int sys_setpriority(int which, int who, int prio)
+{
+	struct proc *p;
+	int errno;
+
+#ifdef __DEBUG__
+	printk("(pid %d) sys_setpriority(%d, %d, %d)\n", current->pid, which, who, prio);
+#endif /*__DEBUG__ */
+
+	if(who < 0) {
+		return -EINVAL;
+	}
+	switch(which) {
+		case PRIO_PROCESS:
+			who = who ? who : current->pid;
+			break;
+		case PRIO_PGRP:
+			who = who ? who : current->pgid;
+			break;
+		case PRIO_USER:
+			who = who ? who : current->uid;
+			break;
+		default:
+			return -EINVAL;
+	}
+	if(prio < MIN_NICE) {
+		prio = MIN_NICE;
+	}
+	if(prio > MAX_NICE) {
+		prio = MAX_NICE;
+	}
+
+	errno = -ESRCH;
+	FOR_EACH_PROCESS(p) {
+		if((which == PRIO_PROCESS && p->pid == who) ||
+		   (which == PRIO_PGRP && p->pgid == who) ||
+		   (which == PRIO_USER && p->uid == who)) {
+			if(!IS_SUPERUSER && current->euid != p->uid && current->euid != p->euid) {
+				errno = -EPERM;
+			} else if(prio < p->nice && !IS_SUPERUSER) {
+				errno = -EACCES;
+			} else {
+				set_nice(p, prio);
+				if(errno == -ESRCH) {
+					errno = 0;
+				}
+			}
+		}
+		p = p->next;
+	}
+	return errno;
+}
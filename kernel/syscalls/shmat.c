@@ -69,29 +69,35 @@ int sys_shmat(int shmid, char *shmaddr, int shmflg, unsigned int *raddr)
 		return -EINVAL;
 	}
 
+	lock_mm(current->mm);
 	addr = (unsigned int)shmaddr;
 	if(addr) {
 		if(shmflg & SHM_RND) {
 			addr &= ~(SHMLBA - 1);
 		} else {
 			if(addr & (SHMLBA - 1)) {
+				unlock_mm(current->mm);
 				return -EINVAL;
 			}
 		}
 		if(find_vma_intersection(addr, addr + seg->shm_segsz)) {
+			unlock_mm(current->mm);
 			return -EINVAL;
 		}
 	} else {
 		if(!(addr = get_unmapped_vma_region(seg->shm_segsz))) {
+			unlock_mm(current->mm);
 			return -ENOMEM;
 		}
 	}
 
 	if(!ipc_has_perms(&seg->shm_perm, shmflg & SHM_RDONLY ? IPC_R : IPC_R | IPC_W)) {
+		unlock_mm(current->mm);
 		return -EACCES;
 	}
 
 	if(!(sega = shm_get_new_attach(seg))) {
+		unlock_mm(current->mm);
 		return -ENOMEM;
 	}
 
@@ -106,6 +112,7 @@ int sys_shmat(int shmid, char *shmaddr, int shmflg, unsigned int *raddr)
 	seg->shm_nattch++;
 
 	errno = do_mmap(NULL, addr, seg->shm_segsz, sega->prot, sega->flags, sega->offset, sega->s_type, sega->o_mode, seg);
+	unlock_mm(current->mm);
 	if(errno < 0 && errno > -PAGE_SIZE) {
 		return errno;
 	}
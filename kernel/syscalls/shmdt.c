@@ -32,16 +32,20 @@ int sys_shmdt(char *shmaddr)
 
 	addr = (unsigned int)shmaddr;
 
+	lock_mm(current->mm);
 	if(!(vma = find_vma_region(addr))) {
 		printk("WARNING: %s(): no vma region found!\n", __FUNCTION__);
+		unlock_mm(current->mm);
 		return 0;
 	}
 	if(vma->s_type != P_SHM) {
 		printk("WARNING: %s(): vma region is not a shared memory!\n", __FUNCTION__);
+		unlock_mm(current->mm);
 		return 0;
 	}
 	if(!(seg = (struct shmid_ds *)vma->object)) {
 		printk("WARNING: %s(): object is NULL!\n", __FUNCTION__);
+		unlock_mm(current->mm);
 		return 0;
 	}
 
@@ -52,6 +56,7 @@ int sys_shmdt(char *shmaddr)
 			seg->shm_nattch--;
 		}
 	}
+	unlock_mm(current->mm);
 
 	return 0;
 }
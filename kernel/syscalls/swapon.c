@@ -0,0 +1,45 @@
+/*
+ * fiwix/kernel/syscalls/swapon.c
+ *
+ * Copyright 2022, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#include <fiwix/fs.h>
+#include <fiwix/process.h>
+#include <fiwix/swap.h>
+#include <fiwix/errno.h>
+#include <fiwix/string.h>
+
+#ifdef __DEBUG__
+#include <fiwix/stdio.h>
+#endif /*__DEBUG__ */
+
+int sys_swapon(const char *specialfile, int flags)
+{
+	struct inode *i;
+	char *tmp_name;
+	int errno;
+
+#ifdef __DEBUG__
+	printk("(pid %d) sys_swapon('%s', 0x%x)\n", current->pid, specialfile, flags);
+#endif /*__DEBUG__ */
+
+	if(!IS_SUPERUSER) {
+		return -EPERM;
+	}
+	if((errno = malloc_name(specialfile, &tmp_name)) < 0) {
+		return errno;
+	}
+	if((errno = namei(tmp_name, &i, NULL, FOLLOW_LINKS))) {
+		free_name(tmp_name);
+		return errno;
+	}
+	free_name(tmp_name);
+
+	/* on success the swap area keeps the inode reference */
+	if((errno = do_swapon(i))) {
+		iput(i);
+	}
+	return errno;
+}
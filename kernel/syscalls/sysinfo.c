@@ -39,8 +39,8 @@ int sys_sysinfo(struct sysinfo *info)
 	tmp_info.freeram = kstat.free_pages << PAGE_SHIFT;
 	tmp_info.sharedram = 0;
 	tmp_info.bufferram = kstat.buffers_size * 1024;
-	tmp_info.totalswap = 0;
-	tmp_info.freeswap = 0;
+	tmp_info.totalswap = kstat.swap_pages << PAGE_SHIFT;
+	tmp_info.freeswap = kstat.free_swap_pages << PAGE_SHIFT;
 	FOR_EACH_PROCESS(p) {
 		tmp_info.procs++;
 		p = p->next;
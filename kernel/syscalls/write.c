@@ -28,7 +28,7 @@ int sys_write(unsigned int ufd, const char *buf, int count)
 	if((errno = check_user_area(VERIFY_READ, buf, count))) {
 		return errno;
 	}
-	if(fd_table[current->fd[ufd]].flags & O_RDONLY) {
+	if(fd_table[current->files->fd[ufd]].flags & O_RDONLY) {
 		return -EBADF;
 	}
 	if(!count) {
@@ -37,9 +37,9 @@ int sys_write(unsigned int ufd, const char *buf, int count)
 	if(count < 0) {
 		return -EINVAL;
 	}
-	i = fd_table[current->fd[ufd]].inode;
+	i = fd_table[current->files->fd[ufd]].inode;
 	if(i->fsop && i->fsop->write) {
-		errno = i->fsop->write(i, &fd_table[current->fd[ufd]], buf, count);
+		errno = i->fsop->write(i, &fd_table[current->files->fd[ufd]], buf, count);
 #ifdef __DEBUG__
 		printk("%d\n", errno);
 #endif /*__DEBUG__ */
@@ -19,26 +19,75 @@
 #include <fiwix/signal.h>
 #include <fiwix/process.h>
 #include <fiwix/sleep.h>
+#include <fiwix/mm.h>
+#include <fiwix/cpu.h>
 #include <fiwix/errno.h>
 #include <fiwix/stdio.h>
 #include <fiwix/string.h>
 
 /*
- * timer.c implements a callout table using a singly linked list.
+ * timer.c implements the callouts using a hierarchical timing wheel.
  *
- *  head
- * +---------+  ----------+  ...  ----------+
- * |data|next|  |data|next|  ...  |data|next|
- * |    |  -->  |    |  -->  ...  |    |  / |
- * +---------+  ----------+  ...  ----------+
- *  (callout)    (callout)         (callout)
+ * The first level (tv1) has one slot for each of the next TVR_SIZE ticks,
+ * and each of the next levels (tvn) covers TVN_SIZE times the range of the
+ * previous one. A callout is placed in the slot of the level that covers
+ * its expiration, and every time the first level wraps around, the callouts
+ * of the next slot of the second level are redistributed (cascaded) among
+ * the slots below it, and so on.
+ *
+ * The callouts are also hashed by fn/arg, which is what identifies them, so
+ * adding and deleting a callout takes constant time.
  */
 
 #define LATCH	(OSCIL / HZ)
 
-struct callout callout_pool[NR_CALLOUTS];
-struct callout *callout_pool_head;
-struct callout *callout_head;
+#define TVR_BITS	8
+#define TVN_BITS	6
+#define TVR_SIZE	(1 << TVR_BITS)
+#define TVN_SIZE	(1 << TVN_BITS)
+#define TVR_MASK	(TVR_SIZE - 1)
+#define TVN_MASK	(TVN_SIZE - 1)
+#define NR_TVN		4		/* levels above the first one */
+#define TVN_INDEX(t, n)	(((t) >> (TVR_BITS + (n) * TVN_BITS)) & TVN_MASK)
+
+/*
+ * Expirations are compared as signed distances, so the ones too far away
+ * would look like already expired. Also leave room for the wheel lagging
+ * behind CURRENT_TICKS.
+ */
+#define MAX_CALLOUT_TICKS	((~0U >> 2) - 1)
+
+#define NR_CALLOUT_HASH		64
+#define CALLOUT_HASH(fn, arg)	((((unsigned int)(fn) >> 2) ^ (arg)) % (NR_CALLOUT_HASH))
+
+static struct callout *tv1[TVR_SIZE];
+static struct callout *tvn[NR_TVN][TVN_SIZE];
+static struct callout *callout_hash[NR_CALLOUT_HASH];
+static struct slab_cache *callout_cache;
+static unsigned int wheel_ticks;	/* next tick to be processed */
+static int nr_callouts;
+
+/*
+ * The callouts are also armed from interrupt handlers and bottom halves,
+ * where slab_alloc() can't be used since it might sleep. So they are always
+ * taken from a small reserve, which is refilled only in process context.
+ */
+#define NR_CALLOUT_RESERVE	16
+
+static struct callout *callout_reserve;
+static int nr_callout_reserve;
+
+/*
+ * When the system is idle the periodic tick is replaced by a one-shot
+ * interrupt programmed at the tick boundary of the next callout, so the CPU
+ * can stay halted. The 16bit counter of the PIT limits this to a few ticks.
+ */
+#define MAX_IDLE_TICKS	(0xFFFF / LATCH)
+
+static int tickless;		/* ticks covered by the idle one-shot */
+static int tickless_count;	/* initial count of the idle one-shot */
+static int oneshot_ticks;	/* ticks to account when the one-shot expires */
+static int pending_ticks;	/* ticks not yet accounted by irq_timer_bh */
 
 static char month[12] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
 unsigned int avenrun[3] = { 0, 0, 0 };
@@ -79,82 +128,202 @@ static void calc_load(void)
 	CALC_LOAD(avenrun[2], EXP_15, active_procs);
 }
 
-static struct callout *get_free_callout(void)
+static void insert_wheel(struct callout *c)
 {
-	struct callout *new;
+	struct callout **slot;
+	unsigned int idx;
+	int n;
+
+	idx = c->expires - wheel_ticks;
+	if((int)idx < 0) {
+		/* already expired, run it on the next tick processed */
+		slot = &tv1[wheel_ticks & TVR_MASK];
+	} else if(idx < TVR_SIZE) {
+		slot = &tv1[c->expires & TVR_MASK];
+	} else {
+		for(n = 0; n < NR_TVN - 1; n++) {
+			if(idx < (1 << (TVR_BITS + (n + 1) * TVN_BITS))) {
+				break;
+			}
+		}
+		slot = &tvn[n][TVN_INDEX(c->expires, n)];
+	}
 
-	new = NULL;
-	if(callout_pool_head) {
-		new = callout_pool_head;
-		callout_pool_head = callout_pool_head->next;
-		new->next = NULL;
+	c->prev = NULL;
+	c->next = *slot;
+	if(*slot) {
+		(*slot)->prev = c;
 	}
-	return new;
+	*slot = c;
+	c->slot = slot;
 }
 
-static void put_free_callout(struct callout *old)
+/* the interrupts must be disabled */
+static struct callout *get_reserved_callout(void)
 {
-	old->next = callout_pool_head;
-	callout_pool_head = old;
+	struct callout *c;
+
+	if((c = callout_reserve)) {
+		callout_reserve = c->next;
+		nr_callout_reserve--;
+	}
+	return c;
 }
 
-static void do_del_callout(struct callout *c)
+/* the interrupts must be disabled */
+static void free_callout(struct callout *c)
 {
-	struct callout **tmp;
+	if(nr_callout_reserve < NR_CALLOUT_RESERVE) {
+		c->next = callout_reserve;
+		callout_reserve = c;
+		nr_callout_reserve++;
+		return;
+	}
+	slab_free(callout_cache, c);
+}
 
-	if(callout_head) {
-		tmp = &callout_head;
-		while(*tmp) {
-			if((*tmp) == c) {
-				if((*tmp)->next != NULL) {
-					*tmp = (*tmp)->next;
-					(*tmp)->expires += c->expires;
-				} else {
-					*tmp = NULL;
-				}
-				put_free_callout(c);
-				break;
-			}
-			tmp = &(*tmp)->next;
+/* this might sleep */
+static void fill_callout_reserve(void)
+{
+	unsigned int flags;
+	struct callout *c;
+
+	while(nr_callout_reserve < NR_CALLOUT_RESERVE) {
+		if(!(c = (struct callout *)slab_alloc(callout_cache))) {
+			break;
+		}
+		SAVE_FLAGS(flags); CLI();
+		free_callout(c);
+		RESTORE_FLAGS(flags);
+	}
+}
+
+static void remove_wheel(struct callout *c)
+{
+	if(c->next) {
+		c->next->prev = c->prev;
+	}
+	if(c->prev) {
+		c->prev->next = c->next;
+	} else {
+		*c->slot = c->next;
+	}
+	c->prev = c->next = NULL;
+	c->slot = NULL;
+}
+
+static struct callout *find_callout(struct callout_req *creq)
+{
+	struct callout *c;
+
+	c = callout_hash[CALLOUT_HASH(creq->fn, creq->arg)];
+	while(c) {
+		if(c->fn == creq->fn && c->arg == creq->arg) {
+			return c;
+		}
+		c = c->next_hash;
+	}
+	return NULL;
+}
+
+static void insert_hash(struct callout *c)
+{
+	struct callout **h;
+
+	h = &callout_hash[CALLOUT_HASH(c->fn, c->arg)];
+	c->prev_hash = NULL;
+	c->next_hash = *h;
+	if(*h) {
+		(*h)->prev_hash = c;
+	}
+	*h = c;
+}
+
+static void remove_hash(struct callout *c)
+{
+	if(c->next_hash) {
+		c->next_hash->prev_hash = c->prev_hash;
+	}
+	if(c->prev_hash) {
+		c->prev_hash->next_hash = c->next_hash;
+	} else {
+		callout_hash[CALLOUT_HASH(c->fn, c->arg)] = c->next_hash;
+	}
+	c->prev_hash = c->next_hash = NULL;
+}
+
+/* redistributes the callouts of a slot among the lower levels */
+static int cascade(int n, int index)
+{
+	struct callout *c, *next;
+
+	c = tvn[n][index];
+	tvn[n][index] = NULL;
+	while(c) {
+		next = c->next;
+		insert_wheel(c);
+		c = next;
+	}
+	return index;
+}
+
+/* returns the number of ticks until the next callout, up to 'max' */
+static int next_callout(int max)
+{
+	unsigned int tick;
+	int n;
+
+	if(!nr_callouts) {
+		return max;
+	}
+	if((int)(CURRENT_TICKS - wheel_ticks) >= 0) {
+		return 0;	/* the wheel is behind */
+	}
+	for(n = 1; n < max; n++) {
+		tick = CURRENT_TICKS + n;
+		if(!(tick & TVR_MASK) || tv1[tick & TVR_MASK]) {
+			break;	/* a cascade might bring callouts too */
 		}
 	}
+	return n;
 }
 
 void add_callout(struct callout_req *creq, unsigned int ticks)
 {
 	unsigned int flags;
-	struct callout *c, **tmp;
+	struct callout *c;
 
-	del_callout(creq);
 	SAVE_FLAGS(flags); CLI();
 
-	if(!(c = get_free_callout())) {
-		printk("WARNING: %s(): no more callout slots!\n", __FUNCTION__);
+	c = find_callout(creq);
+	if(!c && !in_interrupt) {
 		RESTORE_FLAGS(flags);
-		return;
+		fill_callout_reserve();
+		SAVE_FLAGS(flags); CLI();
+		/* it might have been added while the interrupts were enabled */
+		c = find_callout(creq);
 	}
 
-	/* setup the new callout */
-	memset_b(c, 0, sizeof(struct callout));
-	c->expires = ticks;
-	c->fn = creq->fn;
-	c->arg = creq->arg;
-
-	if(!callout_head) {
-		callout_head = c;
+	/* an existing callout with the same fn/arg is just rearmed */
+	if(c) {
+		remove_wheel(c);
 	} else {
-		tmp = &callout_head;
-		while(*tmp) {
-			if((*tmp)->expires > c->expires) {
-				(*tmp)->expires -= c->expires;
-				c->next = *tmp;
-				break;
-			}
-			c->expires -= (*tmp)->expires;
-			tmp = &(*tmp)->next;
+		if(!(c = get_reserved_callout())) {
+			RESTORE_FLAGS(flags);
+			printk("WARNING: %s(): unable to allocate a callout!\n", __FUNCTION__);
+			return;
+		}
+		memset_b(c, 0, sizeof(struct callout));
+		c->fn = creq->fn;
+		c->arg = creq->arg;
+		insert_hash(c);
+		/* an empty wheel is not processed, resynchronize it */
+		if(!nr_callouts++ && (int)(CURRENT_TICKS - wheel_ticks) > 0) {
+			wheel_ticks = CURRENT_TICKS;
 		}
-		*tmp = c;
 	}
+	c->expires = CURRENT_TICKS + MIN(ticks, MAX_CALLOUT_TICKS);
+	insert_wheel(c);
 	RESTORE_FLAGS(flags);
 }
 
@@ -164,27 +333,201 @@ void del_callout(struct callout_req *creq)
 	struct callout *c;
 
 	SAVE_FLAGS(flags); CLI();
-	c = callout_head;
-	while(c) {
-		if(c->fn == creq->fn && c->arg == creq->arg) {
-			do_del_callout(c);
-			break;
+	if((c = find_callout(creq))) {
+		remove_wheel(c);
+		remove_hash(c);
+		nr_callouts--;
+		free_callout(c);
+	}
+	RESTORE_FLAGS(flags);
+}
+
+/* returns the ticks left for a callout to expire, or 0 if it's not pending */
+unsigned int get_callout(struct callout_req *creq)
+{
+	unsigned int flags, ticks;
+	struct callout *c;
+
+	ticks = 0;
+	SAVE_FLAGS(flags); CLI();
+	if((c = find_callout(creq))) {
+		ticks = c->expires - CURRENT_TICKS;
+		if((int)ticks <= 0) {
+			ticks = 1;	/* it will run on the next tick */
 		}
-		c = c->next;
 	}
 	RESTORE_FLAGS(flags);
+	return ticks;
 }
 
-void irq_timer(int num, struct sigcontext *sc)
+static void timeout_expired(unsigned int arg)
+{
+	struct proc *p;
+
+	p = (struct proc *)arg;
+	p->timeout = 0;
+	wakeup_proc(p);
+}
+
+static void it_real_expired(unsigned int arg)
+{
+	struct proc *p;
+	struct callout_req creq;
+
+	p = (struct proc *)arg;
+	if(p->it_real_interval) {
+		creq.fn = it_real_expired;
+		creq.arg = arg;
+		add_callout(&creq, p->it_real_interval);
+	}
+	send_sig(p, SIGALRM);
+}
+
+/*
+ * Arms the sleep timeout of a process. When it expires, p->timeout is
+ * cleared and the process is woken up. INFINITE_WAIT means no timeout.
+ */
+void set_timeout(struct proc *p, unsigned int ticks)
+{
+	struct callout_req creq;
+
+	creq.fn = timeout_expired;
+	creq.arg = (unsigned int)p;
+	p->timeout = ticks;
+	if(ticks && ticks != INFINITE_WAIT) {
+		add_callout(&creq, ticks);
+	} else {
+		del_callout(&creq);
+	}
+}
+
+/* cancels the sleep timeout of a process and returns the ticks left */
+unsigned int del_timeout(struct proc *p)
 {
-	if((++kstat.ticks % HZ) == 0) {
-		CURRENT_TIME++;
-		kstat.uptime++;
+	unsigned int flags, ticks;
+	struct callout_req creq;
+
+	creq.fn = timeout_expired;
+	creq.arg = (unsigned int)p;
+	SAVE_FLAGS(flags); CLI();
+	ticks = p->timeout;
+	if(ticks && ticks != INFINITE_WAIT) {
+		ticks = get_callout(&creq);
+		del_callout(&creq);
 	}
+	p->timeout = 0;
+	RESTORE_FLAGS(flags);
+	return ticks;
+}
+
+/* the callouts must not survive the process slot */
+void del_proc_callouts(struct proc *p)
+{
+	struct callout_req creq;
 
+	del_timeout(p);
+	p->it_real_interval = 0;
+	creq.fn = it_real_expired;
+	creq.arg = (unsigned int)p;
+	del_callout(&creq);
+}
+
+static void do_ticks(int ticks)
+{
+	pending_ticks += ticks;
+	while(ticks--) {
+		if((++kstat.ticks % HZ) == 0) {
+			CURRENT_TIME++;
+			kstat.uptime++;
+		}
+	}
 	timer_bh.flags |= BH_ACTIVE;
 }
 
+/*
+ * Called from cpu_idle() with the interrupts disabled. The one-shot is
+ * programmed to expire on a tick boundary, and irq_timer() compensates for
+ * the time taken to resume the periodic mode after it.
+ */
+void timer_idle_enter(void)
+{
+	int ticks, count;
+
+	if(tickless || oneshot_ticks || pending_ticks) {
+		return;
+	}
+	if((ticks = next_callout(MAX_IDLE_TICKS)) < 2) {
+		return;
+	}
+
+	/* the counter is reloaded with LATCH on each tick */
+	count = pit_getcounter0();
+	if(count <= 0 || count > LATCH) {
+		return;
+	}
+	tickless_count = count + (ticks - 1) * LATCH;
+	pit_oneshot(tickless_count);
+	tickless = oneshot_ticks = ticks;
+	kstat.idle_oneshots++;
+}
+
+/*
+ * Called on any interrupt other than the timer. If the CPU was woken up
+ * before the idle one-shot expired, the ticks already elapsed are accounted
+ * and a new one-shot is programmed up to the next tick boundary, where the
+ * periodic mode will be resumed.
+ */
+void timer_idle_exit(void)
+{
+	int count, elapsed;
+
+	if(!tickless) {
+		return;
+	}
+	count = pit_getcounter0();
+	if(count > tickless_count) {
+		/*
+		 * The counter wrapped around, so the one-shot has just expired
+		 * and its interrupt is pending. It will account the last tick.
+		 */
+		do_ticks(tickless - 1);
+		tickless = 0;
+		return;
+	}
+	elapsed = tickless - 1 - (count / LATCH);
+	if(elapsed > 0) {
+		do_ticks(elapsed);
+	}
+	tickless = 0;
+	if(!(count %= LATCH)) {
+		count = 1;
+	}
+	pit_oneshot(count);
+	oneshot_ticks = 1;
+}
+
+void irq_timer(int num, struct sigcontext *sc)
+{
+	int ticks, late;
+
+	ticks = 1;
+	if(oneshot_ticks) {
+		/* the one-shot expired on a tick boundary */
+		ticks = oneshot_ticks;
+		tickless = oneshot_ticks = 0;
+
+		/*
+		 * The counter kept decrementing past 0 since then, so the time
+		 * taken to get here is discounted from the first period, and
+		 * the tick phase doesn't drift on every idle period.
+		 */
+		late = (0x10000 - pit_getcounter0()) & 0xFFFF;
+		ticks += late / LATCH;
+		pit_periodic(MAX(LATCH - (late % LATCH), 2), HZ);
+	}
+	do_ticks(ticks);
+}
+
 unsigned int tv2ticks(const struct timeval *tv)
 {
 	return((tv->tv_sec * HZ) + tv->tv_usec * HZ / 1000000);
@@ -196,16 +539,50 @@ void ticks2tv(int ticks, struct timeval *tv)
 	tv->tv_usec = (ticks % HZ) * 1000000 / HZ;
 }
 
+int getitimer(int which, struct itimerval *curr_value)
+{
+	struct callout_req creq;
+
+	switch(which) {
+		case ITIMER_REAL:
+			creq.fn = it_real_expired;
+			creq.arg = (unsigned int)current;
+			ticks2tv(current->it_real_interval, &curr_value->it_interval);
+			ticks2tv(get_callout(&creq), &curr_value->it_value);
+			break;
+		case ITIMER_VIRTUAL:
+			ticks2tv(current->it_virt_interval, &curr_value->it_interval);
+			ticks2tv(current->it_virt_value, &curr_value->it_value);
+			break;
+		case ITIMER_PROF:
+			ticks2tv(current->it_prof_interval, &curr_value->it_interval);
+			ticks2tv(current->it_prof_value, &curr_value->it_value);
+			break;
+		default:
+			return -EINVAL;
+	}
+	return 0;
+}
+
 int setitimer(int which, const struct itimerval *new_value, struct itimerval *old_value)
 {
+	struct callout_req creq;
+	unsigned int ticks;
+
 	switch(which) {
 		case ITIMER_REAL:
+			creq.fn = it_real_expired;
+			creq.arg = (unsigned int)current;
 			if((unsigned int)old_value) {
 				ticks2tv(current->it_real_interval, &old_value->it_interval);
-				ticks2tv(current->it_real_value, &old_value->it_value);
+				ticks2tv(get_callout(&creq), &old_value->it_value);
 			}
 			current->it_real_interval = tv2ticks(&new_value->it_interval);
-			current->it_real_value = tv2ticks(&new_value->it_value);
+			if((ticks = tv2ticks(&new_value->it_value))) {
+				add_callout(&creq, ticks);
+			} else {
+				del_callout(&creq);
+			}
 			break;
 		case ITIMER_VIRTUAL:
 			if((unsigned int)old_value) {
@@ -255,10 +632,8 @@ unsigned int mktime(struct mt *mt)
 	return seconds;
 }
 
-void irq_timer_bh(struct sigcontext *sc)
+static void account_tick(struct sigcontext *sc)
 {
-	struct proc *p;
-
 	if(sc->cs == KERNEL_CS) {
 		current->usage.ru_stime.tv_usec += TICK;
 		if(current->usage.ru_stime.tv_usec >= 1000000) {
@@ -275,7 +650,11 @@ void irq_timer_bh(struct sigcontext *sc)
 			current->usage.ru_utime.tv_usec -= 1000000;
 		}
 		if(current->pid != IDLE) {
-			kstat.cpu_user++;
+			if(current->nice > 0) {
+				kstat.cpu_nice++;
+			} else {
+				kstat.cpu_user++;
+			}
 		}
 		if(current->it_virt_value > 0) {
 			current->it_virt_value--;
@@ -299,63 +678,98 @@ void irq_timer_bh(struct sigcontext *sc)
 	}
 
 	calc_load();
-	FOR_EACH_PROCESS(p) {
-		if(p->timeout > 0 && p->timeout < INFINITE_WAIT) {
-			p->timeout--;
-			if(!p->timeout) {
-				wakeup_proc(p);
-			}
-		}
-		if(p->it_real_value > 0) {
-			p->it_real_value--;
-			if(!p->it_real_value) {
-				p->it_real_value = p->it_real_interval;
-				send_sig(p, SIGALRM);
-			}
-		}
-		p = p->next;
+
+	/* running consumes the interactivity bonus */
+	if(current->pid > IDLE && current->sleep_avg > 0) {
+		current->sleep_avg--;
+	}
+	/* SCHED_FIFO processes run until they block or yield */
+	if(current->pid > IDLE && current->policy != SCHED_FIFO && --current->cpu_count <= 0) {
+		current->cpu_count = 0;
+		need_resched = 1;
+	}
+}
+
+void irq_timer_bh(struct sigcontext *sc)
+{
+	unsigned long long int tsc;
+	unsigned int flags;
+	int ticks;
+
+	tsc = (_cpuflags & CPU_TSC) ? get_rdtsc() : 0;
+
+	SAVE_FLAGS(flags); CLI();
+	ticks = pending_ticks;
+	pending_ticks = 0;
+	RESTORE_FLAGS(flags);
+
+	/* more than one tick only after an idle one-shot */
+	while(ticks-- > 0) {
+		account_tick(sc);
 	}
 
 	/* callouts */
-	if(callout_head) {
-		if(callout_head->expires > 0) {
-			callout_head->expires--;
-			if(!callout_head->expires) {
-				callouts_bh.flags |= BH_ACTIVE;
-			}
-		} else {
-			printk("%s(): callout losing ticks.\n", __FUNCTION__);
-			callouts_bh.flags |= BH_ACTIVE;
-		}
+	if(nr_callouts) {
+		callouts_bh.flags |= BH_ACTIVE;
 	}
 
-	if(current->pid > IDLE && --current->cpu_count <= 0) {
-		current->cpu_count = 0;
-		need_resched = 1;
+	/* the cost of a tick doesn't depend on the number of processes */
+	if(tsc) {
+		kstat.timer_bh_cycles += (unsigned int)(get_rdtsc() - tsc);
 	}
 }
 
 void do_callouts_bh(struct sigcontext *sc)
 {
-	struct callout *c;
+	unsigned int flags, now;
+	struct callout *c, *list;
 	void (*fn)(unsigned int);
 	unsigned int arg;
+	int index, n;
 
-	while(callout_head) {
-		if(callout_head->expires) {
-			break;
+	if(lock_area(AREA_CALLOUT)) {
+		return;
+	}
+
+	SAVE_FLAGS(flags); CLI();
+	now = CURRENT_TICKS;
+	while(nr_callouts && (int)(now - wheel_ticks) >= 0) {
+		index = wheel_ticks & TVR_MASK;
+		if(!index) {
+			for(n = 0; n < NR_TVN; n++) {
+				if(cascade(n, TVN_INDEX(wheel_ticks, n))) {
+					break;
+				}
+			}
 		}
-		if(lock_area(AREA_CALLOUT)) {
-			break;
+
+		/*
+		 * The expired callouts are moved to a private list before
+		 * running them, so the new callouts added meanwhile will
+		 * never land on the slot being processed.
+		 */
+		list = tv1[index];
+		tv1[index] = NULL;
+		for(c = list; c; c = c->next) {
+			c->slot = &list;
+		}
+		wheel_ticks++;
+
+		while((c = list)) {
+			remove_wheel(c);
+			remove_hash(c);
+			nr_callouts--;
+			kstat.callouts++;
+			fn = c->fn;
+			arg = c->arg;
+			free_callout(c);
+			RESTORE_FLAGS(flags);
+			fn(arg);
+			SAVE_FLAGS(flags); CLI();
 		}
-		fn = callout_head->fn;
-		arg = callout_head->arg;
-		c = callout_head;
-		callout_head = callout_head->next;
-		put_free_callout(c);
-		unlock_area(AREA_CALLOUT);
-		fn(arg);
 	}
+	RESTORE_FLAGS(flags);
+	unlock_area(AREA_CALLOUT);
 }
 
 void get_system_time(void)
@@ -441,24 +855,20 @@ int gettimeoffset(void)
 
 void timer_init(void)
 {
-	int n;
-	struct callout *c;
-
 	add_bh(&timer_bh);
 	add_bh(&callouts_bh);
 
 	pit_init(HZ);
 
-	memset_b(callout_pool, 0, sizeof(callout_pool));
-
-	/* callout free list initialization */
-	callout_pool_head = NULL;
-	n = NR_CALLOUTS;
-	while(n--) {
-		c = &callout_pool[n];
-		put_free_callout(c);
-	}
-	callout_head = NULL;
+	memset_b(tv1, 0, sizeof(tv1));
+	memset_b(tvn, 0, sizeof(tvn));
+	memset_b(callout_hash, 0, sizeof(callout_hash));
+	callout_cache = slab_cache_create("callout", sizeof(struct callout), NULL);
+	callout_reserve = NULL;
+	nr_callout_reserve = 0;
+	fill_callout_reserve();
+	wheel_ticks = CURRENT_TICKS;
+	nr_callouts = 0;
 
 	printk("clock     -                 %d\ttype=PIT Hz=%d\n", TIMER_IRQ, HZ);
 	if(!register_irq(TIMER_IRQ, &irq_config_timer)) {
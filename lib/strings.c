@@ -204,79 +204,126 @@ int atoi(const char *str)
 	return n;
 }
 
+/*
+ * The memcpy_* and memset_* functions use the string instructions of the
+ * CPU for bulk transfers. Copies smaller than MEMOP_SMALL bytes are done
+ * by a plain loop, since the setup of 'rep' is not worth for them.
+ */
 void memcpy_b(void *dest, const void *src, unsigned int count)
 {
 	unsigned char *d;
 	unsigned char *s;
-
-	d = (unsigned char *)dest;
-	s = (unsigned char *)src;
-	while(count--) {
-		*d = *s;
-		d++;
-		s++;
+	int d0, d1, d2;
+
+	if(count < MEMOP_SMALL) {
+		d = (unsigned char *)dest;
+		s = (unsigned char *)src;
+		while(count--) {
+			*d = *s;
+			d++;
+			s++;
+		}
+		return;
 	}
+
+	__asm__ __volatile__(
+		"cld\n\t"
+		"rep movsl\n\t"
+		"movl %4, %%ecx\n\t"
+		"rep movsb\n\t"
+		: "=&c" (d0), "=&D" (d1), "=&S" (d2)
+		: "0" (count >> 2), "g" (count & 3), "1" (dest), "2" (src)
+		: "memory"
+	);
 }
 
 void memcpy_w(void *dest, const void *src, unsigned int count)
 {
-	unsigned short int *d;
-	unsigned short int *s;
-
-	d = (unsigned short int *)dest;
-	s = (unsigned short int *)src;
-	while(count--) {
-		*d = *s;
-		d++;
-		s++;
-	}
+	int d0, d1, d2;
+
+	__asm__ __volatile__(
+		"cld\n\t"
+		"rep movsw\n\t"
+		: "=&c" (d0), "=&D" (d1), "=&S" (d2)
+		: "0" (count), "1" (dest), "2" (src)
+		: "memory"
+	);
 }
 
 void memcpy_l(void *dest, const void *src, unsigned int count)
 {
-	unsigned int *d;
-	unsigned int *s;
-
-	d = (unsigned int *)dest;
-	s = (unsigned int *)src;
-	while(count--) {
-		*d = *s;
-		d++;
-		s++;
-	}
+	int d0, d1, d2;
+
+	__asm__ __volatile__(
+		"cld\n\t"
+		"rep movsl\n\t"
+		: "=&c" (d0), "=&D" (d1), "=&S" (d2)
+		: "0" (count), "1" (dest), "2" (src)
+		: "memory"
+	);
 }
 
 void memset_b(void *dest, unsigned char value, unsigned int count)
 {
 	unsigned char *d;
-	
-	d = (unsigned char *)dest;
-	while(count--) {
-		*d = value;
-		d++;
+	int d0, d1;
+
+	if(count < MEMOP_SMALL) {
+		d = (unsigned char *)dest;
+		while(count--) {
+			*d = value;
+			d++;
+		}
+		return;
 	}
+
+	__asm__ __volatile__(
+		"cld\n\t"
+		"rep stosl\n\t"
+		"movl %3, %%ecx\n\t"
+		"rep stosb\n\t"
+		: "=&c" (d0), "=&D" (d1)
+		: "a" ((unsigned int)(value & 0xFF) * 0x01010101U), "g" (count & 3), "0" (count >> 2), "1" (dest)
+		: "memory"
+	);
 }
 
 void memset_w(void *dest, unsigned short int value, unsigned int count)
 {
-	unsigned short int *d;
-	
-	d = (unsigned short int *)dest;
-	while(count--) {
-		*d = value;
-		d++;
-	}
+	int d0, d1;
+
+	__asm__ __volatile__(
+		"cld\n\t"
+		"rep stosw\n\t"
+		: "=&c" (d0), "=&D" (d1)
+		: "a" (value), "0" (count), "1" (dest)
+		: "memory"
+	);
 }
 
 void memset_l(void *dest, unsigned int value, unsigned int count)
 {
-	unsigned int *d;
-	
-	d = (unsigned int *)dest;
-	while(count--) {
-		*d = value;
-		d++;
-	}
+	int d0, d1;
+
+	__asm__ __volatile__(
+		"cld\n\t"
+		"rep stosl\n\t"
+		: "=&c" (d0), "=&D" (d1)
+		: "a" (value), "0" (count), "1" (dest)
+		: "memory"
+	);
+}
+
+/* copy a whole page, both addresses must be page aligned */
+void copy_page(void *dest, const void *src)
+{
+	memcpy_l(dest, src, PAGE_SIZE / sizeof(unsigned int));
+}
+
+/* zero-fill a whole page, the address must be page aligned */
+void clear_page(void *dest)
+{
+	memset_l(dest, 0, PAGE_SIZE / sizeof(unsigned int));
 }
 
 #ifdef __TINYC__
@@ -11,11 +11,12 @@
 #include <fiwix/string.h>
 
 /*
- * The kmalloc() function acts like a front-end for the two
+ * The kmalloc() function acts like a front-end for the three
  * memory allocators currently supported:
  *
- * - buddy_low() for requests up to 2048KB.
+ * - buddy_low() for requests up to 2048 bytes.
  * - get_free_page() rest of requests up to PAGE_SIZE.
+ * - buddy_high() for contiguous requests bigger than PAGE_SIZE.
  */
 unsigned int kmalloc(__size_t size)
 {
@@ -30,10 +31,8 @@ unsigned int kmalloc(__size_t size)
 		return bl_malloc(size);
 	}
 
-	/* FIXME: pending to implement buddy_high */
 	if(size > PAGE_SIZE) {
-		printk("WARNING: %s(): size (%d) is bigger than PAGE_SIZE!\n", __FUNCTION__, size);
-		return 0;
+		return bh_malloc(size);
 	}
 
 	if((pg = get_free_page())) {
@@ -55,6 +54,10 @@ void kfree(unsigned int addr)
 
 	if(pg->flags & PAGE_BUDDYLOW) {
 		bl_free(addr);
+	} else if(pg->flags & PAGE_BUDDYHIGH) {
+		bh_free(addr);
+	} else if(pg->flags & PAGE_SLAB) {
+		slab_free(((struct slab *)(addr & PAGE_MASK))->cache, (void *)addr);
 	} else {
 		release_page(pg);
 	}
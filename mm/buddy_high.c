@@ -0,0 +1,209 @@
+/*
+ * fiwix/mm/buddy_high.c
+ *
+ * Copyright 2022, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+/*
+ * This buddy algorithm is intended to handle memory requests bigger than
+ * a PAGE_SIZE. It returns physically contiguous blocks of (2^order) pages,
+ * from order 0 up to BUDDY_HIGH_MAX_ORDER.
+ *
+ * Blocks are taken from the page pool only when no free block of the same
+ * or higher order is available. Freed blocks are coalesced with their
+ * buddies and kept on their free lists until kswapd gives them back to the
+ * page pool through buddy_high_reclaim().
+ */
+
+#include <fiwix/asm.h>
+#include <fiwix/kernel.h>
+#include <fiwix/mm.h>
+#include <fiwix/stdio.h>
+#include <fiwix/string.h>
+
+static struct page *freelist[BUDDY_HIGH_MAX_ORDER + 1];
+
+static void insert_on_freelist(struct page *pg, int order)
+{
+	struct page **h;
+
+	h = &freelist[order];
+	pg->order = order;
+	pg->prev_free = NULL;
+	pg->next_free = *h;
+	if(*h) {
+		(*h)->prev_free = pg;
+	}
+	*h = pg;
+	kstat.buddy_high_free[order]++;
+}
+
+static void remove_from_freelist(struct page *pg)
+{
+	if(pg->next_free) {
+		pg->next_free->prev_free = pg->prev_free;
+	}
+	if(pg->prev_free) {
+		pg->prev_free->next_free = pg->next_free;
+	}
+	if(pg == freelist[pg->order]) {
+		freelist[pg->order] = pg->next_free;
+	}
+	pg->prev_free = pg->next_free = NULL;
+	kstat.buddy_high_free[pg->order]--;
+}
+
+static struct page *get_buddy(struct page *pg, int order)
+{
+	int page;
+
+	page = pg->page ^ (1 << order);
+	if(!is_valid_page(page)) {
+		return NULL;
+	}
+	return &page_table[page];
+}
+
+static void set_block_count(struct page *pg, int order, int count)
+{
+	int n;
+
+	for(n = 0; n < (1 << order); n++) {
+		pg[n].count = count;
+	}
+}
+
+static struct page *allocate(int order)
+{
+	struct page *pg, *buddy;
+	int n, level;
+
+	for(level = order; level <= BUDDY_HIGH_MAX_ORDER; level++) {
+		if(freelist[level]) {
+			break;
+		}
+	}
+
+	if(level > BUDDY_HIGH_MAX_ORDER) {
+		/* no free blocks, get a new one from the page pool */
+		if(!(pg = get_contig_pages(1 << order))) {
+			return NULL;
+		}
+		for(n = 0; n < (1 << order); n++) {
+			pg[n].flags |= PAGE_BUDDYHIGH;
+		}
+		kstat.buddy_high_num_pages += (1 << order);
+		pg->order = order;
+		return pg;
+	}
+
+	pg = freelist[level];
+	remove_from_freelist(pg);
+
+	/* split a bigger block putting the upper halves on the free lists */
+	while(level > order) {
+		level--;
+		buddy = pg + (1 << level);
+		insert_on_freelist(buddy, level);
+	}
+
+	pg->order = order;
+	set_block_count(pg, order, 1);
+	return pg;
+}
+
+static void deallocate(struct page *pg)
+{
+	struct page *buddy;
+	int order;
+
+	order = pg->order;
+	set_block_count(pg, order, 0);
+
+	while(order < BUDDY_HIGH_MAX_ORDER) {
+		if(!(buddy = get_buddy(pg, order))) {
+			break;
+		}
+		if(!(buddy->flags & PAGE_BUDDYHIGH) || buddy->count || buddy->order != order) {
+			break;
+		}
+		remove_from_freelist(buddy);
+		if(buddy < pg) {
+			pg = buddy;
+		}
+		order++;
+	}
+
+	insert_on_freelist(pg, order);
+}
+
+unsigned int bh_malloc(__size_t size)
+{
+	unsigned int flags, addr;
+	struct page *pg;
+	int order;
+
+	for(order = 0; (PAGE_SIZE << order) < size; order++);
+
+	if(order > BUDDY_HIGH_MAX_ORDER) {
+		printk("WARNING: %s(): size (%d) is bigger than the maximum order!\n", __FUNCTION__, size);
+		return 0;
+	}
+
+	SAVE_FLAGS(flags); CLI();
+	if(!(pg = allocate(order))) {
+		RESTORE_FLAGS(flags);
+		printk("WARNING: %s(): not enough contiguous memory (order %d)!\n", __FUNCTION__, order);
+		return 0;
+	}
+	kstat.buddy_high_count[order]++;
+	RESTORE_FLAGS(flags);
+
+	addr = pg->page << PAGE_SHIFT;
+	return P2V(addr);
+}
+
+void bh_free(unsigned int addr)
+{
+	unsigned int flags;
+	struct page *pg;
+
+	pg = &page_table[V2P(addr) >> PAGE_SHIFT];
+
+	SAVE_FLAGS(flags); CLI();
+	kstat.buddy_high_count[pg->order]--;
+	deallocate(pg);
+	RESTORE_FLAGS(flags);
+}
+
+/* give all free blocks back to the page pool */
+int buddy_high_reclaim(void)
+{
+	unsigned int flags;
+	struct page *pg;
+	int n, order, reclaimed;
+
+	reclaimed = 0;
+	SAVE_FLAGS(flags); CLI();
+	for(order = 0; order <= BUDDY_HIGH_MAX_ORDER; order++) {
+		while((pg = freelist[order])) {
+			remove_from_freelist(pg);
+			for(n = 0; n < (1 << order); n++) {
+				pg[n].flags &= ~PAGE_BUDDYHIGH;
+				pg[n].count = 1;
+				release_page(&pg[n]);
+			}
+			kstat.buddy_high_num_pages -= (1 << order);
+			reclaimed += (1 << order);
+		}
+	}
+	RESTORE_FLAGS(flags);
+
+	return reclaimed;
+}
+
+void buddy_high_init(void)
+{
+	memset_b(freelist, 0, sizeof(freelist));
+}
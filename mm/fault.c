@@ -19,6 +19,7 @@
 #include <fiwix/string.h>
 #include <fiwix/syscalls.h>
 #include <fiwix/shm.h>
+#include <fiwix/swap.h>
 
 /* send the SIGSEGV signal to the ofending process */
 static void send_sigsegv(struct sigcontext *sc)
@@ -42,15 +43,45 @@ static int page_protection_violation(struct vma *vma, unsigned int cr2, struct s
 	pde = GET_PGDIR(cr2);
 	pte = GET_PGTBL(cr2);
 	pgdir = (unsigned int *)P2V(current->tss.cr3);
+
+	/* write-protected by mprotect(), even if the page table is shared */
+	if(!(vma->prot & PROT_WRITE)) {
+		send_sigsegv(sc);
+		return 0;
+	}
+
+	/* page table shared after a fork() */
+	if(!(pgdir[pde] & PAGE_RW)) {
+		if(unshare_page_table(current, cr2)) {
+			return 1;
+		}
+		pgtbl = (unsigned int *)P2V((pgdir[pde] & PAGE_MASK));
+		if(pgtbl[pte] & PAGE_RW) {
+			return 0;
+		}
+	}
+
 	pgtbl = (unsigned int *)P2V((pgdir[pde] & PAGE_MASK));
 	page = (pgtbl[pte] & PAGE_MASK) >> PAGE_SHIFT;
 
 	pg = &page_table[page];
 
-	/* Copy On Write feature */
-	if(pg->count > 1) {
+	/* first write on the shared zero page */
+	if(pg == zero_page) {
+		if(!(pg = get_zeroed_page())) {
+			printk("%s(): not enough memory!\n", __FUNCTION__);
+			return 1;
+		}
+		pgtbl[pte] = V2P((unsigned int)pg->data) | PAGE_PRESENT | PAGE_RW | PAGE_USER;
+		release_page(zero_page);
+		invalidate_tlb_page(cr2);
+		return 0;
+	}
+
+	/* Copy On Write feature, a cached page is never written in place */
+	if(pg->count > 1 || (pg->inode && !(vma->flags & MAP_SHARED))) {
 		/* a page not marked as copy-on-write means it's read-only */
-		if(!(pg->flags & PAGE_COW)) {
+		if(!(pg->flags & PAGE_COW) && !pg->inode) {
 			printk("Oops!, page %d NOT marked for CoW.\n", pg->page);
 			send_sigsegv(sc);
 			return 0;
@@ -59,12 +90,12 @@ static int page_protection_violation(struct vma *vma, unsigned int cr2, struct s
 			printk("%s(): not enough memory!\n", __FUNCTION__);
 			return 1;
 		}
-		current->rss++;
-		memcpy_b((void *)addr, (void *)P2V((page << PAGE_SHIFT)), PAGE_SIZE);
+		current->mm->rss++;
+		copy_page((void *)addr, (void *)P2V((page << PAGE_SHIFT)));
 		pgtbl[pte] = V2P(addr) | PAGE_PRESENT | PAGE_RW | PAGE_USER;
 		kfree(P2V((page << PAGE_SHIFT)));
-		current->rss--;
-		invalidate_tlb();
+		current->mm->rss--;
+		invalidate_tlb_page(cr2);
 		return 0;
 	} else {
 		/* last page of Copy On Write procedure */
@@ -76,7 +107,7 @@ static int page_protection_violation(struct vma *vma, unsigned int cr2, struct s
 				return 0;
 			}
 			pgtbl[pte] = (page << PAGE_SHIFT) | PAGE_PRESENT | PAGE_RW | PAGE_USER;
-			invalidate_tlb();
+			invalidate_tlb_page(cr2);
 			return 0;
 		}
 	}
@@ -84,10 +115,61 @@ static int page_protection_violation(struct vma *vma, unsigned int cr2, struct s
 	return 1;
 }
 
+/*
+ * Maps the pages around 'cr2' that are already in the page cache, so that
+ * a cached binary doesn't take a page fault for each one of its pages.
+ */
+static void fault_around(struct vma *vma, unsigned int cr2, char prot)
+{
+	unsigned int *pgdir, *pgtbl;
+	unsigned int start, end, addr, file_offset;
+	struct page *pg;
+
+	if(kparm_faultaround < 2) {
+		return;
+	}
+
+	/* the window never crosses the page table of the faulting address */
+	start = cr2 & ~((PT_ENTRIES << PAGE_SHIFT) - 1);
+	end = start + (PT_ENTRIES << PAGE_SHIFT);
+	addr = cr2 & PAGE_MASK;
+	if(addr - start > (kparm_faultaround / 2) << PAGE_SHIFT) {
+		start = addr - ((kparm_faultaround / 2) << PAGE_SHIFT);
+	}
+	start = MAX(start, vma->start);
+	end = MIN(end, vma->end);
+	end = MIN(end, start + (kparm_faultaround << PAGE_SHIFT));
+
+	pgdir = (unsigned int *)P2V(current->tss.cr3);
+	pgtbl = (unsigned int *)P2V((pgdir[GET_PGDIR(cr2)] & PAGE_MASK));
+	for(addr = start; addr < end; addr += PAGE_SIZE) {
+		if(pgtbl[GET_PGTBL(addr)]) {
+			continue;
+		}
+		file_offset = addr - vma->start + vma->offset;
+		if(file_offset >= vma->inode->i_size) {
+			break;
+		}
+		if(!(pg = get_cached_page(vma->inode, file_offset))) {
+			continue;
+		}
+		if(!map_page(current, addr, V2P((unsigned int)pg->data), prot)) {
+			release_page(pg);
+			break;
+		}
+		if(prot != vma->prot) {
+			pg->flags |= PAGE_COW;
+		}
+		kstat.pgfaultaround++;
+	}
+}
+
 static int page_not_present(struct vma *vma, unsigned int cr2, struct sigcontext *sc)
 {
 	unsigned int addr, file_offset;
 	struct page *pg;
+	int pages;
+	char prot;
 
 	if(!vma) {
 		if(cr2 >= (sc->oldesp - 32) && cr2 < PAGE_OFFSET) {
@@ -99,6 +181,7 @@ static int page_not_present(struct vma *vma, unsigned int cr2, struct sigcontext
 				/* assuming stack will never reach heap */
 				vma->start = cr2;
 				vma->start = vma->start & PAGE_MASK;
+				update_vma_region(vma);
 			}
 		}
 	}
@@ -109,35 +192,68 @@ static int page_not_present(struct vma *vma, unsigned int cr2, struct sigcontext
 		return 0;
 	}
 
+	/* bring the page back from the swap area */
+	if(is_swapped(current, cr2)) {
+		return swap_in(vma, cr2);
+	}
+
 	/* fill the page with its corresponding file content */
 	if(vma->inode) {
 		file_offset = (cr2 & PAGE_MASK) - vma->start + vma->offset;
 		file_offset &= PAGE_MASK;
 		pg = NULL;
 
-		if(!(vma->prot & PROT_WRITE) || vma->flags & MAP_SHARED) {
-			/* check if it's already in cache */
-			if((pg = search_page_hash(vma->inode, file_offset))) {
-				if(!map_page(current, cr2, (unsigned int)V2P(pg->data), vma->prot)) {
-					printk("%s(): Oops, map_page() returned 0!\n", __FUNCTION__);
-					return 1;
-				}
-				page_lock(pg);
-				addr = (unsigned int)pg->data;
+		/*
+		 * The pages of a private writable mapping are also taken from
+		 * the page cache, but they are mapped read-only and marked as
+		 * copy-on-write, so only the first write makes a private copy.
+		 */
+		prot = vma->prot;
+		if(!(vma->flags & MAP_SHARED)) {
+			prot &= ~PROT_WRITE;
+		}
+
+		/* check if it's already in cache */
+		if((pg = search_page_hash(vma->inode, file_offset))) {
+			current->usage.ru_minflt++;
+			if(!map_page(current, cr2, (unsigned int)V2P(pg->data), prot)) {
+				printk("%s(): Oops, map_page() returned 0!\n", __FUNCTION__);
+				return 1;
+			}
+			page_lock(pg);
+			addr = (unsigned int)pg->data;
+			if(pg->flags & PAGE_IOERROR) {
 				page_unlock(pg);
+				unmap_page(cr2);
+				return 1;
 			}
+			page_unlock(pg);
 		}
 		if(!pg) {
-			if(!(addr = map_page(current, cr2, 0, vma->prot))) {
+			if(!(addr = map_page(current, cr2, 0, prot))) {
 				printk("%s(): Oops, map_page() returned 0!\n", __FUNCTION__);
 				return 1;
 			}
 			pg = &page_table[V2P(addr) >> PAGE_SHIFT];
-			if(bread_page(pg, vma->inode, file_offset, vma->prot, vma->flags)) {
+			if(bread_page(pg, vma->inode, file_offset, prot, vma->flags)) {
 				unmap_page(cr2);
 				return 1;
 			}
 			current->usage.ru_majflt++;
+			/* read ahead the next pages of the mapping */
+			if(vma->advice != MADV_RANDOM) {
+				pages = vma->advice == MADV_SEQUENTIAL ? READAHEAD_MAX : READAHEAD_MIN;
+				page_readahead(vma->inode, file_offset + PAGE_SIZE, MIN(pages, (vma->end - (cr2 & PAGE_MASK)) / PAGE_SIZE - 1));
+			}
+		}
+		if(prot != vma->prot) {
+			pg->flags |= PAGE_COW;
+		}
+		if(!(prot & PROT_WRITE) && vma->advice != MADV_RANDOM) {
+			fault_around(vma, cr2, prot);
+		}
+		if(prot != vma->prot && sc->err & PFAULT_W) {
+			return page_protection_violation(vma, cr2, sc);
 		}
 	} else {
 		current->usage.ru_minflt++;
@@ -152,13 +268,31 @@ static int page_not_present(struct vma *vma, unsigned int cr2, struct sigcontext
 	}
 
 	if(vma->flags & ZERO_PAGE) {
+		/* a read maps the shared zero page until the first write */
+		if(!addr && !vma->inode && !(sc->err & PFAULT_W)) {
+			zero_page->count++;
+			if(!map_page(current, cr2, V2P((unsigned int)zero_page->data), vma->prot & ~PROT_WRITE)) {
+				release_page(zero_page);
+				printk("%s(): Oops, map_page() returned 0!\n", __FUNCTION__);
+				return 1;
+			}
+			current->mm->rss++;
+			return 0;
+		}
 		if(!addr) {
-			if(!(addr = map_page(current, cr2, 0, vma->prot))) {
+			if(!(pg = get_zeroed_page())) {
+				printk("%s(): not enough memory!\n", __FUNCTION__);
+				return 1;
+			}
+			if(!map_page(current, cr2, V2P((unsigned int)pg->data), vma->prot)) {
+				release_page(pg);
 				printk("%s(): Oops, map_page() returned 0!\n", __FUNCTION__);
 				return 1;
 			}
+			current->mm->rss++;
+			return 0;
 		}
-		memset_b((void *)(addr & PAGE_MASK), 0, PAGE_SIZE);
+		clear_page((void *)(addr & PAGE_MASK));
 	}
 
 	return 0;
@@ -209,12 +343,10 @@ static int page_not_present(struct vma *vma, unsigned int cr2, struct sigcontext
  * K2 - !vma + kernel + PV + (read | write)	-> PANIC
  *	(!vma page in kernel-mode, page-violation during read or write)
  */
-void do_page_fault(unsigned int trap, struct sigcontext *sc)
+static int handle_page_fault(unsigned int cr2, struct sigcontext *sc)
 {
-	unsigned int cr2;
 	struct vma *vma;
 
-	GET_CR2(cr2);
 	if((vma = find_vma_region(cr2))) {
 
 		/* in user mode */
@@ -224,7 +356,7 @@ void do_page_fault(unsigned int trap, struct sigcontext *sc)
 					if((page_protection_violation(vma, cr2, sc))) {
 						send_sig(current, SIGKILL);
 					}
-					return;
+					return 0;
 				}
 				send_sigsegv(sc);
 			} else {			/* page not present */
@@ -232,7 +364,7 @@ void do_page_fault(unsigned int trap, struct sigcontext *sc)
 					send_sig(current, SIGKILL);
 				}
 			}
-			return;
+			return 0;
 
 		/* in kernel mode */
 		} else {
@@ -245,14 +377,14 @@ void do_page_fault(unsigned int trap, struct sigcontext *sc)
 					send_sig(current, SIGKILL);
 					printk("%s(): kernel was unable to read a page of process '%s' (pid %d).\n", __FUNCTION__, current->argv0, current->pid);
 				}
-				return;
+				return 0;
 			}
 			if(sc->err & PFAULT_W) {	/* copy-on-write? */
 				if((page_protection_violation(vma, cr2, sc))) {
 					send_sig(current, SIGKILL);
 					printk("%s(): kernel was unable to write a page of process '%s' (pid %d).\n", __FUNCTION__, current->argv0, current->pid);
 				}
-				return;
+				return 0;
 			}
 		}
 	} else {
@@ -265,7 +397,7 @@ void do_page_fault(unsigned int trap, struct sigcontext *sc)
 					send_sig(current, SIGKILL);
 				}
 			}
-			return;
+			return 0;
 
 		/* in kernel mode */
 		} else {
@@ -294,7 +426,7 @@ void do_page_fault(unsigned int trap, struct sigcontext *sc)
 			/* does it look like a user stack address? */
 			if(cr2 >= (usc->oldesp - 32) && cr2 < PAGE_OFFSET) {
 				if((!page_not_present(vma, cr2, usc))) {
-					return;
+					return 0;
 				}
 			}
 
@@ -302,6 +434,25 @@ void do_page_fault(unsigned int trap, struct sigcontext *sc)
 		}
 	}
 
+	return 1;
+}
+
+void do_page_fault(unsigned int trap, struct sigcontext *sc)
+{
+	unsigned int cr2;
+	struct mm *mm;
+
+	GET_CR2(cr2);
+
+	/* the vma can't be unmapped by a sharing process while this one sleeps */
+	mm = current->mm;
+	lock_mm(mm);
+	if(!handle_page_fault(cr2, sc)) {
+		unlock_mm(mm);
+		return;
+	}
+	unlock_mm(mm);
+
 	dump_registers(trap, sc);
 	show_vma_regions(current);
 	do_exit(SIGTERM);
@@ -8,6 +8,7 @@
 
 #include <fiwix/kernel.h>
 #include <fiwix/asm.h>
+#include <fiwix/cpu.h>
 #include <fiwix/multiboot1.h>
 #include <fiwix/mm.h>
 #include <fiwix/mman.h>
@@ -19,12 +20,14 @@
 #include <fiwix/kexec.h>
 #include <fiwix/stdio.h>
 #include <fiwix/string.h>
+#include <fiwix/swap.h>
 
 #define KERNEL_TEXT_SIZE	((int)_etext - (PAGE_OFFSET + KERNEL_ADDR))
 #define KERNEL_DATA_SIZE	((int)_edata - (int)_etext)
 #define KERNEL_BSS_SIZE		((int)_end - (int)_edata)
 
 unsigned int *kpage_dir;
+struct page *zero_page;		/* shared zero-filled page */
 
 unsigned int proc_table_size = 0;
 unsigned int buffer_hash_table_size = 0;
@@ -34,10 +37,37 @@ unsigned int fd_table_size = 0;
 unsigned int page_table_size = 0;
 unsigned int page_hash_table_size = 0;
 
+/* kernel mappings are the same in all processes, keep them in the TLB */
+static unsigned int kernel_page_flags(unsigned int vaddr)
+{
+	if(cpu_table.flags & CPU_PGE && vaddr >= PAGE_OFFSET) {
+		return PAGE_GLOBAL;
+	}
+	return 0;
+}
+
+/* replaces a 4MB page of the kernel direct map by a page table */
+static int split_large_page(unsigned int *page_dir, unsigned int pde)
+{
+	unsigned int *pgtbl;
+	unsigned int n, base, flags;
+
+	if(!(pgtbl = (unsigned int *)kmalloc(PAGE_SIZE))) {
+		return 1;
+	}
+	base = page_dir[pde] & PAGE_MASK;
+	flags = page_dir[pde] & ~(PAGE_MASK | PAGE_4MB);
+	for(n = 0; n < PT_ENTRIES; n++) {
+		pgtbl[n] = (base + (n << PAGE_SHIFT)) | flags;
+	}
+	page_dir[pde] = V2P((unsigned int)pgtbl) | PAGE_PRESENT | PAGE_RW;
+	return 0;
+}
+
 unsigned int map_kaddr(unsigned int *page_dir, unsigned int from, unsigned int to, unsigned int addr, int flags)
 {
 	unsigned int n;
-	unsigned int paddr;
+	unsigned int paddr, desc;
 	unsigned int *pgtbl;
 	unsigned int pde, pte;
 
@@ -45,6 +75,12 @@ unsigned int map_kaddr(unsigned int *page_dir, unsigned int from, unsigned int t
 	for(n = from; n < to; n += PAGE_SIZE) {
 		pde = GET_PGDIR(n);
 		pte = GET_PGTBL(n);
+		if(page_dir[pde] & PAGE_4MB) {
+			if(split_large_page(page_dir, pde)) {
+				printk("%s(): no memory\n", __FUNCTION__);
+				return 0;
+			}
+		}
 		if(!(page_dir[pde] & ~PAGE_MASK)) {
 			if (!addr) {
 				paddr = kmalloc(PAGE_SIZE);
@@ -55,11 +91,15 @@ unsigned int map_kaddr(unsigned int *page_dir, unsigned int from, unsigned int t
 				paddr = V2P(paddr);
 			}
 			page_dir[pde] = paddr | flags;
-			memset_b((void *)(paddr + PAGE_OFFSET), 0, PAGE_SIZE);
+			clear_page((void *)(paddr + PAGE_OFFSET));
 			paddr += PAGE_SIZE;
 		}
 		pgtbl = (unsigned int *)((page_dir[pde] & PAGE_MASK) + PAGE_OFFSET);
-		pgtbl[pte] = n | flags;
+		desc = pgtbl[pte];
+		pgtbl[pte] = n | flags | kernel_page_flags(n);
+		if(desc & PAGE_PRESENT) {
+			invalidate_tlb_page(n);
+		}
 	}
 
 	return paddr;
@@ -133,13 +173,123 @@ unsigned int get_mapped_addr(struct proc *p, unsigned int addr)
 	pde = GET_PGDIR(addr);
 	pte = GET_PGTBL(addr);
 	pgtbl = (unsigned int *)P2V((pgdir[pde] & PAGE_MASK));
+	if(!(pgtbl[pte] & PAGE_PRESENT)) {
+		return 0;
+	}
 	return pgtbl[pte];
 }
 
+/*
+ * Gives the process 'p' its own copy of the page table covering 'vaddr' if
+ * it is still shared with other processes after a fork(). All the pages
+ * mapped in it are then write-protected in both tables and their counters
+ * increased, so the copy-on-write procedure continues page by page.
+ */
+int unshare_page_table(struct proc *p, unsigned int vaddr)
+{
+	unsigned int *pgdir, *src_pgtbl, *dst_pgtbl;
+	unsigned int pde, pte, addr;
+	struct page *pg;
+
+	pgdir = (unsigned int *)P2V(p->tss.cr3);
+	pde = GET_PGDIR(vaddr);
+	if((pgdir[pde] & (PAGE_PRESENT | PAGE_RW | PAGE_USER)) != (PAGE_PRESENT | PAGE_USER)) {
+		return 0;
+	}
+
+	/* the other processes have already left this page table */
+	pg = &page_table[pgdir[pde] >> PAGE_SHIFT];
+	if(pg->count == 1) {
+		pgdir[pde] |= PAGE_RW;
+		invalidate_tlb();
+		return 0;
+	}
+
+	if(!(addr = kmalloc(PAGE_SIZE))) {
+		printk("%s(): not enough memory!\n", __FUNCTION__);
+		return 1;
+	}
+	/* kmalloc() might have slept */
+	if(pg->count == 1) {
+		kfree(addr);
+		pgdir[pde] |= PAGE_RW;
+		invalidate_tlb();
+		return 0;
+	}
+	src_pgtbl = (unsigned int *)P2V((pgdir[pde] & PAGE_MASK));
+	dst_pgtbl = (unsigned int *)addr;
+	copy_page(dst_pgtbl, src_pgtbl);
+
+	for(pte = 0; pte < PT_ENTRIES; pte++) {
+		if(IS_SWP_ENTRY(src_pgtbl[pte])) {
+			swap_duplicate(src_pgtbl[pte]);
+			continue;
+		}
+		if(!(src_pgtbl[pte] & PAGE_PRESENT) || src_pgtbl[pte] & PAGE_NOALLOC) {
+			continue;
+		}
+		pg = &page_table[src_pgtbl[pte] >> PAGE_SHIFT];
+		if(pg->flags & PAGE_RESERVED) {
+			continue;
+		}
+		/* mark writable pages as copy-on-write */
+		if(src_pgtbl[pte] & PAGE_RW) {
+			pg->flags |= PAGE_COW;
+		}
+		src_pgtbl[pte] &= ~PAGE_RW;
+		dst_pgtbl[pte] &= ~PAGE_RW;
+		pg->count++;
+	}
+
+	kfree(P2V(pgdir[pde]) & PAGE_MASK);
+	pgdir[pde] = V2P(addr) | PAGE_PRESENT | PAGE_RW | PAGE_USER;
+	invalidate_tlb();
+	return 0;
+}
+
+/*
+ * Drops the references of the process 'p' to the page tables that it still
+ * shares with other processes, leaving the pages mapped in them untouched.
+ */
+void release_shared_page_tables(struct proc *p)
+{
+	unsigned int *pgdir, *pgtbl;
+	unsigned int pde, pte;
+	struct page *pg;
+
+	pgdir = (unsigned int *)P2V(p->tss.cr3);
+	for(pde = 0; pde < GET_PGDIR(PAGE_OFFSET); pde++) {
+		if((pgdir[pde] & (PAGE_PRESENT | PAGE_RW | PAGE_USER)) != (PAGE_PRESENT | PAGE_USER)) {
+			continue;
+		}
+		pg = &page_table[pgdir[pde] >> PAGE_SHIFT];
+		if(pg->count == 1) {
+			pgdir[pde] |= PAGE_RW;
+			continue;
+		}
+		pgtbl = (unsigned int *)P2V((pgdir[pde] & PAGE_MASK));
+		for(pte = 0; pte < PT_ENTRIES; pte++) {
+			if(pgtbl[pte] & PAGE_PRESENT) {
+				p->mm->rss--;
+			}
+		}
+		kfree((unsigned int)pgtbl);
+		p->mm->rss--;
+		pgdir[pde] = 0;
+	}
+}
+
+/*
+ * The page tables that only map private pages are shared read-only with
+ * the child, and split later by unshare_page_table() on the first write
+ * fault. Page tables that also map MAP_SHARED or shm regions are copied
+ * page by page, since these pages must not become copy-on-write.
+ */
 int clone_pages(struct proc *child)
 {
 	unsigned int *src_pgdir, *dst_pgdir;
 	unsigned int *src_pgtbl, *dst_pgtbl;
+	unsigned int noshare[PD_ENTRIES / 32];
 	unsigned int pde, pte;
 	unsigned int p_addr, c_addr;
 	unsigned int n, pages;
@@ -148,9 +298,18 @@ int clone_pages(struct proc *child)
 
 	src_pgdir = (unsigned int *)P2V(current->tss.cr3);
 	dst_pgdir = (unsigned int *)P2V(child->tss.cr3);
-	vma = current->vma_table;
 	pages = 0;
 
+	memset_b(noshare, 0, sizeof(noshare));
+	for(vma = current->mm->vma_table; vma; vma = vma->next) {
+		if(vma->flags & MAP_SHARED || vma->object) {
+			for(pde = GET_PGDIR(vma->start); pde <= GET_PGDIR(vma->end - 1); pde++) {
+				noshare[pde / 32] |= 1 << (pde % 32);
+			}
+		}
+	}
+
+	vma = current->mm->vma_table;
 	while(vma) {
 		if(vma->flags & MAP_SHARED) {
 			vma = vma->next;
@@ -159,41 +318,60 @@ int clone_pages(struct proc *child)
 		for(n = vma->start; n < vma->end; n += PAGE_SIZE) {
 			pde = GET_PGDIR(n);
 			pte = GET_PGTBL(n);
-			if(src_pgdir[pde] & PAGE_PRESENT) {
-				src_pgtbl = (unsigned int *)P2V((src_pgdir[pde] & PAGE_MASK));
+			if(!(src_pgdir[pde] & PAGE_PRESENT)) {
+				continue;
+			}
+			if(!(noshare[pde / 32] & (1 << (pde % 32)))) {
 				if(!(dst_pgdir[pde] & PAGE_PRESENT)) {
-					if(!(c_addr = kmalloc(PAGE_SIZE))) {
-						printk("%s(): returning 0!\n", __FUNCTION__);
-						return 0;
-					}
-					current->rss++;
+					src_pgdir[pde] &= ~PAGE_RW;
+					dst_pgdir[pde] = src_pgdir[pde];
+					pg = &page_table[src_pgdir[pde] >> PAGE_SHIFT];
+					pg->count++;
 					pages++;
-					dst_pgdir[pde] = V2P(c_addr) | PAGE_PRESENT | PAGE_RW | PAGE_USER;
-					memset_b((void *)c_addr, 0, PAGE_SIZE);
 				}
-				dst_pgtbl = (unsigned int *)P2V((dst_pgdir[pde] & PAGE_MASK));
-				if(src_pgtbl[pte] & PAGE_PRESENT) {
-					if (src_pgtbl[pte] & PAGE_NOALLOC) {
-						dst_pgtbl[pte] = src_pgtbl[pte];
-						continue;
-					}
-					p_addr = src_pgtbl[pte] >> PAGE_SHIFT;
-					pg = &page_table[p_addr];
-					if(pg->flags & PAGE_RESERVED) {
-						continue;
-					}
-					src_pgtbl[pte] &= ~PAGE_RW;
-					/* mark writable pages as copy-on-write */
-					if(vma->prot & PROT_WRITE) {
-						pg->flags |= PAGE_COW;
-					}
+				continue;
+			}
+			if(unshare_page_table(current, n)) {
+				return 0;
+			}
+			src_pgtbl = (unsigned int *)P2V((src_pgdir[pde] & PAGE_MASK));
+			if(!(dst_pgdir[pde] & PAGE_PRESENT)) {
+				if(!(pg = get_zeroed_page())) {
+					printk("%s(): returning 0!\n", __FUNCTION__);
+					return 0;
+				}
+				c_addr = (unsigned int)pg->data;
+				current->mm->rss++;
+				pages++;
+				dst_pgdir[pde] = V2P(c_addr) | PAGE_PRESENT | PAGE_RW | PAGE_USER;
+			}
+			dst_pgtbl = (unsigned int *)P2V((dst_pgdir[pde] & PAGE_MASK));
+			if(IS_SWP_ENTRY(src_pgtbl[pte])) {
+				dst_pgtbl[pte] = src_pgtbl[pte];
+				swap_duplicate(src_pgtbl[pte]);
+				continue;
+			}
+			if(src_pgtbl[pte] & PAGE_PRESENT) {
+				if (src_pgtbl[pte] & PAGE_NOALLOC) {
 					dst_pgtbl[pte] = src_pgtbl[pte];
-					if(!is_valid_page((dst_pgtbl[pte] & PAGE_MASK) >> PAGE_SHIFT)) {
-						PANIC("%s: missing page %d during copy-on-write process.\n", __FUNCTION__, (dst_pgtbl[pte] & PAGE_MASK) >> PAGE_SHIFT);
-					}
-					pg = &page_table[(dst_pgtbl[pte] & PAGE_MASK) >> PAGE_SHIFT];
-					pg->count++;
+					continue;
+				}
+				p_addr = src_pgtbl[pte] >> PAGE_SHIFT;
+				pg = &page_table[p_addr];
+				if(pg->flags & PAGE_RESERVED) {
+					continue;
+				}
+				src_pgtbl[pte] &= ~PAGE_RW;
+				/* mark writable pages as copy-on-write */
+				if(vma->prot & PROT_WRITE) {
+					pg->flags |= PAGE_COW;
 				}
+				dst_pgtbl[pte] = src_pgtbl[pte];
+				if(!is_valid_page((dst_pgtbl[pte] & PAGE_MASK) >> PAGE_SHIFT)) {
+					PANIC("%s: missing page %d during copy-on-write process.\n", __FUNCTION__, (dst_pgtbl[pte] & PAGE_MASK) >> PAGE_SHIFT);
+				}
+				pg = &page_table[(dst_pgtbl[pte] & PAGE_MASK) >> PAGE_SHIFT];
+				pg->count++;
 			}
 		}
 		vma = vma->next;
@@ -208,7 +386,8 @@ int free_page_tables(struct proc *p)
 
 	pgdir = (unsigned int *)P2V(p->tss.cr3);
 	for(n = 0, count = 0; n < PD_ENTRIES; n++) {
-		if((pgdir[n] & (PAGE_PRESENT | PAGE_RW | PAGE_USER)) == (PAGE_PRESENT | PAGE_RW | PAGE_USER)) {
+		/* shared page tables (read-only) only lose a reference */
+		if((pgdir[n] & (PAGE_PRESENT | PAGE_USER)) == (PAGE_PRESENT | PAGE_USER)) {
 			kfree(P2V(pgdir[n]) & PAGE_MASK);
 			pgdir[n] = 0;
 			count++;
@@ -226,19 +405,23 @@ unsigned int map_page_flags(struct proc *p, unsigned int vaddr, unsigned int add
 {
 	unsigned int *pgdir, *pgtbl;
 	unsigned int newaddr;
+	struct page *pg;
 	int pde, pte;
 
 	pgdir = (unsigned int *)P2V(p->tss.cr3);
 	pde = GET_PGDIR(vaddr);
 	pte = GET_PGTBL(vaddr);
 
+	if(unshare_page_table(p, vaddr)) {
+		return 0;
+	}
 	if(!(pgdir[pde] & PAGE_PRESENT)) {	/* allocating page table */
-		if(!(newaddr = kmalloc(PAGE_SIZE))) {
+		if(!(pg = get_zeroed_page())) {
 			return 0;
 		}
-		p->rss++;
+		newaddr = (unsigned int)pg->data;
+		p->mm->rss++;
 		pgdir[pde] = V2P(newaddr) | PAGE_PRESENT | PAGE_RW | PAGE_USER;
-		memset_b((void *)newaddr, 0, PAGE_SIZE);
 	}
 	pgtbl = (unsigned int *)P2V((pgdir[pde] & PAGE_MASK));
 	if(!(pgtbl[pte] & PAGE_PRESENT)) {	/* allocating page */
@@ -247,7 +430,7 @@ unsigned int map_page_flags(struct proc *p, unsigned int vaddr, unsigned int add
 				return 0;
 			}
 			addr = V2P(addr);
-			p->rss++;
+			p->mm->rss++;
 		}
 		pgtbl[pte] = addr | PAGE_PRESENT | PAGE_USER | flags;
 	}
@@ -270,6 +453,9 @@ int unmap_page(unsigned int vaddr)
 		printk("WARNING: %s(): trying to unmap an unallocated pde '0x%08x'\n", __FUNCTION__, vaddr);
 		return 1;
 	}
+	if(unshare_page_table(current, vaddr)) {
+		return 1;
+	}
 
 	pgtbl = (unsigned int *)P2V((pgdir[pde] & PAGE_MASK));
 	if(!(pgtbl[pte] & PAGE_PRESENT)) {
@@ -280,13 +466,89 @@ int unmap_page(unsigned int vaddr)
 	desc = pgtbl[pte];
 	addr = desc & PAGE_MASK;
 	pgtbl[pte] = 0;
+	invalidate_tlb_page(vaddr);
 	if (!(desc & PAGE_NOALLOC)) {
 		kfree(P2V(addr));
 	}
-	current->rss--;
+	current->mm->rss--;
 	return 0;
 }
 
+/*
+ * Moves the page table entries of a range of the current process to
+ * another address, so its pages (and swap entries) are relocated without
+ * copying their contents. All the page tables needed are prepared first,
+ * so nothing is moved if memory runs out.
+ */
+int move_page_range(unsigned int from, unsigned int to, __size_t length)
+{
+	unsigned int *pgdir, *src_pgtbl, *dst_pgtbl;
+	unsigned int n, src, dst, pde, pte;
+	struct page *pg;
+
+	pgdir = (unsigned int *)P2V(current->tss.cr3);
+	for(n = 0; n < length; n += PAGE_SIZE) {
+		src = from + n;
+		dst = to + n;
+		if(!(pgdir[GET_PGDIR(src)] & PAGE_PRESENT)) {
+			continue;
+		}
+		if(unshare_page_table(current, src) || unshare_page_table(current, dst)) {
+			return 1;
+		}
+		if(!(pgdir[GET_PGDIR(dst)] & PAGE_PRESENT)) {
+			if(!(pg = get_zeroed_page())) {
+				return 1;
+			}
+			current->mm->rss++;
+			pgdir[GET_PGDIR(dst)] = V2P((unsigned int)pg->data) | PAGE_PRESENT | PAGE_RW | PAGE_USER;
+		}
+	}
+
+	for(n = 0; n < length; n += PAGE_SIZE) {
+		src = from + n;
+		dst = to + n;
+		if(!(pgdir[GET_PGDIR(src)] & PAGE_PRESENT)) {
+			continue;
+		}
+		src_pgtbl = (unsigned int *)P2V((pgdir[GET_PGDIR(src)] & PAGE_MASK));
+		dst_pgtbl = (unsigned int *)P2V((pgdir[GET_PGDIR(dst)] & PAGE_MASK));
+		dst_pgtbl[GET_PGTBL(dst)] = src_pgtbl[GET_PGTBL(src)];
+		src_pgtbl[GET_PGTBL(src)] = 0;
+	}
+
+	/* free the page tables left empty */
+	for(pde = GET_PGDIR(from); pde <= GET_PGDIR(from + length - 1); pde++) {
+		if(!(pgdir[pde] & PAGE_PRESENT)) {
+			continue;
+		}
+		src_pgtbl = (unsigned int *)P2V((pgdir[pde] & PAGE_MASK));
+		for(pte = 0; pte < PT_ENTRIES; pte++) {
+			if(src_pgtbl[pte]) {
+				break;
+			}
+		}
+		if(pte == PT_ENTRIES) {
+			kfree((unsigned int)src_pgtbl);
+			current->mm->rss--;
+			pgdir[pde] = 0;
+		}
+	}
+	invalidate_tlb();
+	return 0;
+}
+
+/* flushes the TLB entry of a single page of the current address space */
+void invalidate_tlb_page(unsigned int vaddr)
+{
+	/* the INVLPG instruction appeared with the i486 */
+	if(cpu_table.family >= 4) {
+		INVLPG(vaddr);
+	} else {
+		invalidate_tlb();
+	}
+}
+
 /*
  * This function initializes and setups the kernel page directory and page
  * tables. It also reserves areas of contiguous memory spaces for internal
@@ -297,9 +559,25 @@ void mem_init(void)
 	unsigned int sizek;
 	unsigned int physical_memory, physical_page_tables;
 	unsigned int *pgtbl;
-	int n, pages, last_ramdisk;
+	unsigned int cr4, cr4_flags, global, large_pages;
+	int n, pte, pages, last_ramdisk;
 
-	physical_page_tables = (kstat.physical_pages / 1024) + ((kstat.physical_pages % 1024) ? 1 : 0);
+	/*
+	 * The direct map uses 4MB pages, except for the last partial 4MB.
+	 *
+	 * There is no 4MB backing for user regions (anonymous or SysV shm),
+	 * and no mmap() flag or madvise() advice to ask for it; user regions
+	 * are always backed by 4KB pages. get_contig_pages() can provide
+	 * naturally aligned 4MB blocks, but all the walkers of the user page
+	 * tables (fork, unsharing, swap, munmap, mremap, page cache aging)
+	 * expect a page table behind each Page Directory entry.
+	 */
+	large_pages = 0;
+	if(cpu_table.flags & CPU_PSE) {
+		large_pages = kstat.physical_pages / PT_ENTRIES;
+	}
+	n = kstat.physical_pages - (large_pages * PT_ENTRIES);
+	physical_page_tables = (n / 1024) + ((n % 1024) ? 1 : 0);
 	physical_memory = (kstat.physical_pages << PAGE_SHIFT);	/* in bytes */
 
 	/* align _last_data_addr to the next page */
@@ -316,12 +594,29 @@ void mem_init(void)
 	_last_data_addr += physical_page_tables * PAGE_SIZE;
 
 	/* Page Directory and Page Tables initialization */
-	for(n = 0; n < kstat.physical_pages; n++) {
-		pgtbl[n] = (n << PAGE_SHIFT) | PAGE_PRESENT | PAGE_RW;
+	global = kernel_page_flags(PAGE_OFFSET);
+	for(n = 0; n < large_pages; n++) {
+		kpage_dir[GET_PGDIR(PAGE_OFFSET) + n] = ((n * PT_ENTRIES) << PAGE_SHIFT) | PAGE_PRESENT | PAGE_RW | PAGE_4MB | global;
+	}
+	for(n = large_pages * PT_ENTRIES, pte = 0; n < kstat.physical_pages; n++, pte++) {
+		pgtbl[pte] = (n << PAGE_SHIFT) | PAGE_PRESENT | PAGE_RW | global;
 		if(!(n % 1024)) {
-			kpage_dir[GET_PGDIR(PAGE_OFFSET) + (n / 1024)] = (unsigned int)&pgtbl[n] | PAGE_PRESENT | PAGE_RW;
+			kpage_dir[GET_PGDIR(PAGE_OFFSET) + (n / 1024)] = (unsigned int)&pgtbl[pte] | PAGE_PRESENT | PAGE_RW;
 		}
 	}
+
+	/* 4MB pages must be enabled before activating the Page Directory */
+	cr4_flags = 0;
+	if(cpu_table.flags & CPU_PSE) {
+		cr4_flags |= CR4_PSE;
+	}
+	if(cpu_table.flags & CPU_PGE) {
+		cr4_flags |= CR4_PGE;
+	}
+	if(cr4_flags) {
+		GET_CR4(cr4);
+		SET_CR4(cr4 | cr4_flags);
+	}
 	activate_kpage_dir();
 
 	/* since Page Directory is now activated we can use virtual addresses */
@@ -460,6 +755,15 @@ void mem_init(void)
 
 	page_init(kstat.physical_pages);
 	buddy_low_init();
+	buddy_high_init();
+	vma_cache = slab_cache_create("vma", sizeof(struct vma), NULL);
+	mm_cache = slab_cache_create("mm", sizeof(struct mm), NULL);
+
+	/* this page is never freed since it keeps a reference for itself */
+	if(!(zero_page = get_free_page())) {
+		PANIC("Unable to allocate the zero page.\n");
+	}
+	clear_page(zero_page->data);
 }
 
 void mem_stats(void)
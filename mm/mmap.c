@@ -9,14 +9,24 @@
 #include <fiwix/asm.h>
 #include <fiwix/mm.h>
 #include <fiwix/fs.h>
+#include <fiwix/buffer.h>
 #include <fiwix/fcntl.h>
 #include <fiwix/stat.h>
 #include <fiwix/process.h>
+#include <fiwix/sched.h>
+#include <fiwix/sleep.h>
 #include <fiwix/mman.h>
 #include <fiwix/errno.h>
 #include <fiwix/stdio.h>
 #include <fiwix/string.h>
 #include <fiwix/shm.h>
+#include <fiwix/swap.h>
+
+#define NR_WRITEBACK	32	/* pages pinned by a writeback batch */
+
+struct slab_cache *vma_cache;
+struct slab_cache *mm_cache;
+struct mm kernel_mm = { 1, 1 };
 
 void merge_vma_regions(struct vma *, struct vma *);
 
@@ -30,7 +40,7 @@ void show_vma_regions(struct proc *p)
 	unsigned int n;
 	int count;
 
-	vma = p->vma_table;
+	vma = p->mm->vma_table;
 	n = 0;
 	printk("num  address range         flag offset     dev   inode      mod section cnt\n");
 	printk("---- --------------------- ---- ---------- ----- ---------- --- ------- ----\n");
@@ -83,39 +93,257 @@ void show_vma_regions(struct proc *p)
 	}
 }
 
-/* insert a vma structure into vma_table sorted by address */
-static void insert_vma_region(struct vma *vma)
+/*
+ * The vma_table list is also indexed by an AVL tree (vma_tree) sorted by
+ * start address in the same order as the list. Every node keeps the size
+ * of the biggest hole found below the start of a vma in its subtree, so
+ * get_unmapped_vma_region() doesn't need to scan the whole list.
+ */
+#define VMA_HEIGHT(v)	((v) ? (v)->height : 0)
+
+/* vmas with the same start address are sorted in list order */
+static int vma_before(struct vma *a, struct vma *b)
+{
+	if(a->start != b->start) {
+		return a->start < b->start;
+	}
+	for(a = a->next; a && a->start == b->start; a = a->next) {
+		if(a == b) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/* the hole between a vma and the previous one */
+static unsigned int vma_gap(struct proc *p, struct vma *vma)
 {
-	struct vma *vmat;
+	unsigned int prev_end;
+
+	prev_end = vma == p->mm->vma_table ? 0 : vma->prev->end;
+	return vma->start > prev_end ? vma->start - prev_end : 0;
+}
 
-	vmat = current->vma_table;
+static void vma_fixup(struct proc *p, struct vma *vma)
+{
+	unsigned int gap;
 
-	while(vmat) {
-		if(vmat->start > vma->start) {
-			break;
+	vma->height = 1 + MAX(VMA_HEIGHT(vma->left), VMA_HEIGHT(vma->right));
+	gap = vma_gap(p, vma);
+	if(vma->left) {
+		gap = MAX(gap, vma->left->max_gap);
+	}
+	if(vma->right) {
+		gap = MAX(gap, vma->right->max_gap);
+	}
+	vma->max_gap = gap;
+}
+
+static struct vma *rotate_left(struct proc *p, struct vma *vma)
+{
+	struct vma *r;
+
+	r = vma->right;
+	vma->right = r->left;
+	r->left = vma;
+	vma_fixup(p, vma);
+	vma_fixup(p, r);
+	return r;
+}
+
+static struct vma *rotate_right(struct proc *p, struct vma *vma)
+{
+	struct vma *l;
+
+	l = vma->left;
+	vma->left = l->right;
+	l->right = vma;
+	vma_fixup(p, vma);
+	vma_fixup(p, l);
+	return l;
+}
+
+static struct vma *balance(struct proc *p, struct vma *vma)
+{
+	int bf;
+
+	vma_fixup(p, vma);
+	bf = VMA_HEIGHT(vma->left) - VMA_HEIGHT(vma->right);
+	if(bf > 1) {
+		if(VMA_HEIGHT(vma->left->left) < VMA_HEIGHT(vma->left->right)) {
+			vma->left = rotate_left(p, vma->left);
 		}
-		vmat = vmat->next;
+		return rotate_right(p, vma);
+	}
+	if(bf < -1) {
+		if(VMA_HEIGHT(vma->right->right) < VMA_HEIGHT(vma->right->left)) {
+			vma->right = rotate_right(p, vma->right);
+		}
+		return rotate_left(p, vma);
+	}
+	return vma;
+}
+
+static struct vma *tree_insert(struct proc *p, struct vma *root, struct vma *vma)
+{
+	if(!root) {
+		vma->left = vma->right = NULL;
+		vma_fixup(p, vma);
+		return vma;
 	}
+	if(vma_before(vma, root)) {
+		root->left = tree_insert(p, root->left, vma);
+	} else {
+		root->right = tree_insert(p, root->right, vma);
+	}
+	return balance(p, root);
+}
+
+static struct vma *tree_remove_min(struct proc *p, struct vma *root, struct vma **min)
+{
+	if(!root->left) {
+		*min = root;
+		return root->right;
+	}
+	root->left = tree_remove_min(p, root->left, min);
+	return balance(p, root);
+}
+
+/* 'vma' must be already removed from the vma_table list */
+static struct vma *tree_delete(struct proc *p, struct vma *root, struct vma *vma)
+{
+	struct vma *min;
 
-	if(!vmat) {
-		/* append */
-		vma->prev = current->vma_table->prev;
-		current->vma_table->prev->next = vma;
-		current->vma_table->prev = vma;
+	if(!root) {
+		return NULL;
+	}
+	if(root == vma) {
+		if(!root->left) {
+			return root->right;
+		}
+		if(!root->right) {
+			return root->left;
+		}
+		root->right = tree_remove_min(p, root->right, &min);
+		min->left = root->left;
+		min->right = root->right;
+		return balance(p, min);
+	}
+	if(vma_before(vma, root)) {
+		root->left = tree_delete(p, root->left, vma);
 	} else {
-		/* insert */
-		vma->prev = vmat->prev;
-		vma->next = vmat;
-		if(vmat == current->vma_table) {
-			/* insert in the head */
-			current->vma_table = vma;
+		root->right = tree_delete(p, root->right, vma);
+	}
+	return balance(p, root);
+}
+
+/* recalculates the nodes from the root down to 'vma' after its hole changed */
+static void tree_refresh(struct proc *p, struct vma *root, struct vma *vma)
+{
+	if(!root) {
+		return;
+	}
+	if(root != vma) {
+		if(vma_before(vma, root)) {
+			tree_refresh(p, root->left, vma);
+		} else {
+			tree_refresh(p, root->right, vma);
+		}
+	}
+	vma_fixup(p, root);
+}
+
+/* returns the last vma starting at or below 'addr' */
+static struct vma *tree_lookup(struct proc *p, unsigned int addr)
+{
+	struct vma *vma, *found;
+
+	found = NULL;
+	vma = p->mm->vma_tree;
+	while(vma) {
+		if(addr < vma->start) {
+			vma = vma->left;
 		} else {
+			found = vma;
+			vma = vma->right;
+		}
+	}
+	return found;
+}
+
+static struct vma *build_tree(struct proc *p, struct vma **list, int count)
+{
+	struct vma *left, *root;
+
+	if(!count) {
+		return NULL;
+	}
+	left = build_tree(p, list, count / 2);
+	root = *list;
+	*list = root->next;
+	root->left = left;
+	root->right = build_tree(p, list, count - count / 2 - 1);
+	vma_fixup(p, root);
+	return root;
+}
+
+/* builds a balanced vma_tree from an already sorted vma_table */
+void build_vma_tree(struct proc *p)
+{
+	struct vma *vma;
+	int count;
+
+	count = 0;
+	for(vma = p->mm->vma_table; vma; vma = vma->next) {
+		count++;
+	}
+	vma = p->mm->vma_table;
+	p->mm->vma_tree = build_tree(p, &vma, count);
+	p->mm->vma_hint = NULL;
+}
+
+/* must be called after changing the limits of a vma in place */
+void update_vma_region(struct vma *vma)
+{
+	tree_refresh(current, current->mm->vma_tree, vma);
+	if(vma->next) {
+		tree_refresh(current, current->mm->vma_tree, vma->next);
+	}
+}
+
+/* links a vma structure into vma_table sorted by address */
+static void link_vma_region(struct vma *vma)
+{
+	struct vma *prev;
+
+	if(!(prev = tree_lookup(current, vma->start))) {
+		/* insert in the head */
+		vma->prev = current->mm->vma_table->prev;
+		vma->next = current->mm->vma_table;
+		current->mm->vma_table->prev = vma;
+		current->mm->vma_table = vma;
+	} else {
+		vma->prev = prev;
+		vma->next = prev->next;
+		if(prev->next) {
 			/* insert in the middle */
-			vmat->prev->next = vma;
+			prev->next->prev = vma;
+		} else {
+			/* append */
+			current->mm->vma_table->prev = vma;
 		}
-		vmat->prev = vma;
+		prev->next = vma;
+	}
+	current->mm->vma_tree = tree_insert(current, current->mm->vma_tree, vma);
+	if(vma->next) {
+		tree_refresh(current, current->mm->vma_tree, vma->next);
 	}
+}
 
+/* insert a vma structure into vma_table sorted by address */
+static void insert_vma_region(struct vma *vma)
+{
+	link_vma_region(vma);
 	if(vma != vma->prev && vma->start >= vma->prev->start && vma->start <= vma->prev->end) {
 		merge_vma_regions(vma->prev, vma);
 	}
@@ -126,9 +354,10 @@ static void add_vma_region(struct vma *vma)
 	unsigned int flags;
 
 	SAVE_FLAGS(flags); CLI();
-	if(!current->vma_table) {
-		current->vma_table = vma;
-		current->vma_table->prev = vma;
+	if(!current->mm->vma_table) {
+		current->mm->vma_table = vma;
+		current->mm->vma_table->prev = vma;
+		current->mm->vma_tree = tree_insert(current, NULL, vma);
 	} else {
 		insert_vma_region(vma);
 	}
@@ -152,19 +381,26 @@ static void del_vma_region(struct vma *vma)
 		vma->next->prev = vma->prev;
 	}
 	if(vma->prev) {
-		if(vma != current->vma_table) {
+		if(vma != current->mm->vma_table) {
 			vma->prev->next = vma->next;
 		}
 	}
 	if(!vma->next) {
-		current->vma_table->prev = vma->prev;
+		current->mm->vma_table->prev = vma->prev;
 	}
-	if(vma == current->vma_table) {
-		current->vma_table = vma->next;
+	if(vma == current->mm->vma_table) {
+		current->mm->vma_table = vma->next;
+	}
+	current->mm->vma_tree = tree_delete(current, current->mm->vma_tree, vma);
+	if(vma->next) {
+		tree_refresh(current, current->mm->vma_tree, vma->next);
+	}
+	if(current->mm->vma_hint == vma) {
+		current->mm->vma_hint = NULL;
 	}
 	RESTORE_FLAGS(flags);
 
-	kfree((unsigned int)tmp);
+	slab_free(vma_cache, tmp);
 }
 
 static int can_be_merged(struct vma *a, struct vma *b)
@@ -174,6 +410,7 @@ static int can_be_merged(struct vma *a, struct vma *b)
 	   (a->flags == b->flags) &&
 	   (a->offset == b->offset) &&
 	   (a->s_type == b->s_type) &&
+	   (a->advice == b->advice) &&
 #ifdef CONFIG_SYSVIPC
 	   (a->s_type != P_SHM) &&
 #endif /* CONFIG_SYSVIPC */
@@ -189,7 +426,7 @@ static int free_vma_region(struct vma *vma, unsigned int start, __ssize_t length
 	struct vma *new;
 
 	if(start + length < vma->end) {
-		if(!(new = (struct vma *)kmalloc(sizeof(struct vma)))) {
+		if(!(new = (struct vma *)slab_alloc(vma_cache))) {
 			return -ENOMEM;
 		}
 		memset_b(new, 0, sizeof(struct vma));
@@ -201,6 +438,7 @@ static int free_vma_region(struct vma *vma, unsigned int start, __ssize_t length
 		new->s_type = vma->s_type;
 		new->inode = vma->inode;
 		new->o_mode = vma->o_mode;
+		new->advice = vma->advice;
 	} else {
 		new = NULL;
 	}
@@ -212,6 +450,7 @@ static int free_vma_region(struct vma *vma, unsigned int start, __ssize_t length
 		del_vma_region(vma);
 	} else {
 		vma->end = start;
+		update_vma_region(vma);
 	}
 
 	if(new) {
@@ -235,7 +474,7 @@ void merge_vma_regions(struct vma *a, struct vma *b)
 	}
 
 	if((b->start < a->end)) {
-		if(!(new = (struct vma *)kmalloc(sizeof(struct vma)))) {
+		if(!(new = (struct vma *)slab_alloc(vma_cache))) {
 			return;
 		}
 		new->start = b->end;
@@ -246,28 +485,224 @@ void merge_vma_regions(struct vma *a, struct vma *b)
 		new->s_type = a->s_type;
 		new->inode = a->inode;
 		new->o_mode = a->o_mode;
+		new->advice = a->advice;
 		free_vma_pages(a, b->start, b->end - b->start);
 		invalidate_tlb();
 		a->end = b->start;
+		update_vma_region(a);
 		if(a->start == a->end) {
 			del_vma_region(a);
 		}
 		if(new->start >= new->end) {
-			kfree((unsigned int)new);
+			slab_free(vma_cache, new);
 		} else {
 			insert_vma_region(new);
 		}
 	}
 }
 
+/*
+ * Moves the dirty bit of the PTE that maps 'addr' in a shared file mapping
+ * to its page, so the writeback of the page can be deferred. Returns the
+ * page if it has modifications not yet written back.
+ */
+static struct page *get_dirty_page(struct proc *p, unsigned int addr)
+{
+	unsigned int *pgdir, *pgtbl;
+	unsigned int pde, pte;
+	struct page *pg;
+
+	pgdir = (unsigned int *)P2V(p->tss.cr3);
+	pde = GET_PGDIR(addr);
+	pte = GET_PGTBL(addr);
+	if(!(pgdir[pde] & PAGE_PRESENT)) {
+		return NULL;
+	}
+	pgtbl = (unsigned int *)P2V((pgdir[pde] & PAGE_MASK));
+	if((pgtbl[pte] & (PAGE_PRESENT | PAGE_NOALLOC)) != PAGE_PRESENT) {
+		return NULL;
+	}
+	pg = &page_table[pgtbl[pte] >> PAGE_SHIFT];
+	if(pg->flags & PAGE_RESERVED || !pg->inode) {
+		return NULL;
+	}
+	if(pgtbl[pte] & PAGE_DIRTY) {
+		pgtbl[pte] &= ~PAGE_DIRTY;
+		if(p->tss.cr3 == current->tss.cr3) {
+			invalidate_tlb_page(addr);
+		}
+		pg->flags |= PAGE_MODIFIED;
+	}
+	return pg->flags & PAGE_MODIFIED ? pg : NULL;
+}
+
+/*
+ * Marks again as modified the pages of a range whose writeback failed, so
+ * they are not lost and the next writeback tries them again.
+ */
+static void redirty_pages(struct proc *p, unsigned int start, unsigned int end)
+{
+	unsigned int *pgdir, *pgtbl;
+	unsigned int addr;
+	struct page *pg;
+
+	pgdir = (unsigned int *)P2V(p->tss.cr3);
+	for(addr = start; addr < end; addr += PAGE_SIZE) {
+		if(!(pgdir[GET_PGDIR(addr)] & PAGE_PRESENT)) {
+			continue;
+		}
+		pgtbl = (unsigned int *)P2V((pgdir[GET_PGDIR(addr)] & PAGE_MASK));
+		if((pgtbl[GET_PGTBL(addr)] & (PAGE_PRESENT | PAGE_NOALLOC)) != PAGE_PRESENT) {
+			continue;
+		}
+		pg = &page_table[pgtbl[GET_PGTBL(addr)] >> PAGE_SHIFT];
+		if(!(pg->flags & PAGE_RESERVED) && pg->inode) {
+			pg->flags |= PAGE_MODIFIED;
+		}
+	}
+}
+
+static int write_vma_range(struct vma *vma, unsigned int start, unsigned int end)
+{
+	struct inode *i;
+	struct fd fdt;
+	__off_t offset;
+	unsigned int size;
+
+	i = vma->inode;
+	offset = start - vma->start + vma->offset;
+	if(offset >= i->i_size) {
+		return 0;
+	}
+	size = MIN(i->i_size - offset, end - start);
+	fdt.inode = i;
+	fdt.flags = 0;
+	fdt.count = 0;
+	fdt.offset = offset;
+	if(!i->fsop || !i->fsop->write) {
+		return -EINVAL;
+	}
+	return i->fsop->write(i, &fdt, (char *)start, size);
+}
+
+/*
+ * Writes back the modified pages of a shared file mapping of the current
+ * process. Every run of consecutive dirty pages goes to the filesystem as
+ * a single write, so their blocks are requested together.
+ */
+int writeback_vma_pages(struct vma *vma, unsigned int start, unsigned int end)
+{
+	struct inode *i;
+	struct page *pg;
+	unsigned int addr, run;
+	int errno, retval;
+
+	if(!vma->inode || !(vma->flags & MAP_SHARED) || !(vma->prot & PROT_WRITE)) {
+		return 0;
+	}
+
+	i = vma->inode;
+	i->count++;
+	retval = 0;
+	run = start;
+	for(addr = start; addr < end; addr += PAGE_SIZE) {
+		if((pg = get_dirty_page(current, addr))) {
+			pg->flags &= ~PAGE_MODIFIED;
+			continue;
+		}
+		if(run < addr) {
+			if((errno = write_vma_range(vma, run, addr)) < 0) {
+				redirty_pages(current, run, addr);
+				retval = errno;
+			}
+		}
+		run = addr + PAGE_SIZE;
+	}
+	if(run < end) {
+		if((errno = write_vma_range(vma, run, end)) < 0) {
+			redirty_pages(current, run, end);
+			retval = errno;
+		}
+	}
+	iput(i);
+	return retval;
+}
+
+/*
+ * Writes back the pages modified through the shared file mappings of all
+ * processes, so they don't pile up until the regions are unmapped. The
+ * pages and their inodes are pinned in small batches while the writes,
+ * which might sleep, are in progress.
+ */
+void writeback_shared_mappings(void)
+{
+	struct {
+		struct page *pg;
+		struct inode *inode;
+		__off_t offset;
+	} wb[NR_WRITEBACK];
+	struct proc *p;
+	struct vma *vma;
+	struct page *pg;
+	unsigned int addr;
+	int n, count;
+
+	do {
+		count = 0;
+		FOR_EACH_PROCESS(p) {
+			if(p->flags & PF_KPROC || p->state == PROC_ZOMBIE) {
+				p = p->next;
+				continue;
+			}
+			for(vma = p->mm->vma_table; vma && count < NR_WRITEBACK; vma = vma->next) {
+				if(!vma->inode || !(vma->flags & MAP_SHARED) || !(vma->prot & PROT_WRITE)) {
+					continue;
+				}
+				for(addr = vma->start; addr < vma->end && count < NR_WRITEBACK; addr += PAGE_SIZE) {
+					if(!(pg = get_dirty_page(p, addr))) {
+						continue;
+					}
+					pg->flags &= ~PAGE_MODIFIED;
+					pg->count++;
+					vma->inode->count++;
+					wb[count].pg = pg;
+					wb[count].inode = vma->inode;
+					wb[count].offset = addr - vma->start + vma->offset;
+					count++;
+				}
+			}
+			if(count == NR_WRITEBACK) {
+				break;
+			}
+			p = p->next;
+		}
+
+		for(n = 0; n < count; n++) {
+			if(wb[n].offset < wb[n].inode->i_size) {
+				if(write_page(wb[n].pg, wb[n].inode, wb[n].offset, PAGE_SIZE) < 0 && wb[n].pg->inode) {
+					/* try again on the next writeback */
+					wb[n].pg->flags |= PAGE_MODIFIED;
+				}
+			}
+			release_page(wb[n].pg);
+			iput(wb[n].inode);
+		}
+		if(count == NR_WRITEBACK) {
+			do_sched();
+		}
+	} while(count == NR_WRITEBACK);
+}
+
 void free_vma_pages(struct vma *vma, unsigned int start, __size_t length)
 {
-	unsigned int n, offset;
+	unsigned int n;
 	unsigned int *pgdir, *pgtbl;
 	unsigned int pde, pte;
 	struct page *pg;
 	int page;
 
+	writeback_vma_pages(vma, start, start + length);
+
 	pgdir = (unsigned int *)P2V(current->tss.cr3);
 	pgtbl = NULL;
 
@@ -275,8 +710,13 @@ void free_vma_pages(struct vma *vma, unsigned int start, __size_t length)
 		pde = GET_PGDIR(start + (n * PAGE_SIZE));
 		pte = GET_PGTBL(start + (n * PAGE_SIZE));
 		if(pgdir[pde] & PAGE_PRESENT) {
+			if(unshare_page_table(current, start + (n * PAGE_SIZE))) {
+				continue;
+			}
 			pgtbl = (unsigned int *)P2V((pgdir[pde] & PAGE_MASK));
-			if(pgtbl[pte] & PAGE_PRESENT) {
+			if(IS_SWP_ENTRY(pgtbl[pte])) {
+				swap_free(pgtbl[pte]);
+			} else if(pgtbl[pte] & PAGE_PRESENT) {
 				if (!(pgtbl[pte] & PAGE_NOALLOC)) {
 					/* make sure to not free reserved pages */
 					page = pgtbl[pte] >> PAGE_SHIFT;
@@ -285,42 +725,146 @@ void free_vma_pages(struct vma *vma, unsigned int start, __size_t length)
 						continue;
 					}
 
-					if(vma->prot & PROT_WRITE && vma->flags & MAP_SHARED) {
-						offset = start - vma->start + vma->offset + n * PAGE_SIZE;
-						write_page(pg, vma->inode, offset, PAGE_SIZE);
-					}
-
 					kfree(P2V(pgtbl[pte]) & PAGE_MASK);
 				}
-				current->rss--;
+				current->mm->rss--;
 #ifdef CONFIG_SYSVIPC
 				if(vma->object) {
 					shm_rss--;
 				}
 #endif /* CONFIG_SYSVIPC */
-				pgtbl[pte] = 0;
+			} else {
+				continue;
+			}
+			pgtbl[pte] = 0;
 
-				/* check if a page table can be freed */
-				for(pte = 0; pte < PT_ENTRIES; pte++) {
-					if(pgtbl[pte] & PAGE_MASK) {
-						break;
-					}
-				}
-				if(pte == PT_ENTRIES) {
-					kfree((unsigned int)pgtbl & PAGE_MASK);
-					current->rss--;
-					pgdir[pde] = 0;
+			/* check if a page table can be freed */
+			for(pte = 0; pte < PT_ENTRIES; pte++) {
+				if(pgtbl[pte] & PAGE_MASK) {
+					break;
 				}
 			}
+			if(pte == PT_ENTRIES) {
+				kfree((unsigned int)pgtbl & PAGE_MASK);
+				current->mm->rss--;
+				pgdir[pde] = 0;
+			}
 		}
 	}
 }
 
+struct mm *alloc_mm(void)
+{
+	struct mm *mm;
+
+	if(!(mm = (struct mm *)slab_alloc(mm_cache))) {
+		return NULL;
+	}
+	memset_b(mm, 0, sizeof(struct mm));
+	mm->count = 1;
+	mm->users = 1;
+	return mm;
+}
+
+void put_mm(struct mm *mm)
+{
+	if(!--mm->count) {
+		slab_free(mm_cache, mm);
+	}
+}
+
+/*
+ * The processes sharing an address space can sleep in the middle of a page
+ * fault or of a change in the vmas, so the whole operation is serialized.
+ * The owner can take the lock again, as a fault in kernel mode on behalf of
+ * a system call that already holds it.
+ */
+void lock_mm(struct mm *mm)
+{
+	if(mm->owner == current) {
+		mm->depth++;
+		return;
+	}
+	lock_resource(&mm->lock);
+	mm->owner = current;
+	mm->depth = 1;
+}
+
+void unlock_mm(struct mm *mm)
+{
+	if(--mm->depth) {
+		return;
+	}
+	mm->owner = NULL;
+	unlock_resource(&mm->lock);
+}
+
+/* returns 1 if the address space of 'p' is shared with other processes */
+int is_vm_shared(struct proc *p)
+{
+	return p->mm->users > 1;
+}
+
+/* resumes the parent suspended in vfork() */
+static void vfork_done(void)
+{
+	if(current->flags & PF_VFORK) {
+		current->flags &= ~PF_VFORK;
+		wakeup(current);
+	}
+}
+
+/*
+ * Leaves the address space shared with other processes, which keep using
+ * it, and switches the current process to a new and empty one.
+ */
+int leave_vm(void)
+{
+	struct mm *mm;
+	unsigned int *pgdir;
+	unsigned int old_cr3;
+
+	if(!is_vm_shared(current)) {
+		return 0;
+	}
+
+	if(!(mm = alloc_mm())) {
+		return -ENOMEM;
+	}
+	if(!(pgdir = (void *)kmalloc(PAGE_SIZE))) {
+		put_mm(mm);
+		return -ENOMEM;
+	}
+	copy_page(pgdir, kpage_dir);
+	old_cr3 = current->tss.cr3;
+	current->tss.cr3 = V2P((unsigned int)pgdir);
+	SET_CR3(current->tss.cr3);
+	kfree(P2V(old_cr3));
+
+	/* the kernel stack goes along with the process */
+	current->mm->rss--;
+	current->mm->users--;
+	put_mm(current->mm);
+	current->mm = mm;
+	current->mm->rss = 2;
+	vfork_done();
+	return 0;
+}
+
 void release_binary(void)
 {
 	struct vma *vma, *tmp;
 
-	vma = current->vma_table;
+	/* the rest of processes keep using the address space */
+	if(is_vm_shared(current)) {
+		current->mm->users--;
+		vfork_done();
+		return;
+	}
+
+	/* no need to split the page tables shared with other processes */
+	release_shared_page_tables(current);
+	vma = current->mm->vma_table;
 
 	while(vma) {
 		tmp = vma->next;
@@ -330,42 +874,50 @@ void release_binary(void)
 	}
 
 	invalidate_tlb();
+	vfork_done();
 }
 
-struct vma *find_vma_region(unsigned int addr)
+struct vma *find_proc_vma_region(struct proc *p, unsigned int addr)
 {
 	struct vma *vma;
 
-	if(!addr) {
-		return NULL;
-	}
-
-	addr &= PAGE_MASK;
-	vma = current->vma_table;
-
-	while(vma) {
+	if((vma = p->mm->vma_hint)) {
 		if((addr >= vma->start) && (addr < vma->end)) {
 			return vma;
 		}
-		vma = vma->next;
+	}
+	if((vma = tree_lookup(p, addr))) {
+		if(addr < vma->end) {
+			p->mm->vma_hint = vma;
+			return vma;
+		}
 	}
 	return NULL;
 }
 
+struct vma *find_vma_region(unsigned int addr)
+{
+	if(!addr) {
+		return NULL;
+	}
+
+	return find_proc_vma_region(current, addr & PAGE_MASK);
+}
+
 struct vma *find_vma_intersection(unsigned int start, unsigned int end)
 {
 	struct vma *vma;
 
-	vma = current->vma_table;
-
-	while(vma) {
-		if(end <= vma->start) {
-			break;
-		}
+	if((vma = tree_lookup(current, start))) {
 		if(start < vma->end) {
 			return vma;
 		}
 		vma = vma->next;
+	} else {
+		vma = current->mm->vma_table;
+	}
+	if(vma && vma->start < end) {
+		return vma;
 	}
 	return NULL;
 }
@@ -374,13 +926,14 @@ int expand_heap(unsigned int new)
 {
 	struct vma *vma, *heap;
 
-	vma = current->vma_table;
+	vma = current->mm->vma_table;
 	heap = NULL;
 
 	while(vma) {
 		/* make sure the new heap won't overlap the next region */
 		if(heap && new < vma->start) {
 			heap->end = new;
+			update_vma_region(heap);
 			return 0;
 		} else {
 			heap = NULL;	/* was a bad candidate */
@@ -395,31 +948,37 @@ int expand_heap(unsigned int new)
 	return 1;
 }
 
-/* return the first free address that matches with the size of length */
-unsigned int get_unmapped_vma_region(unsigned int length)
+/* searches the lowest hole above MMAP_START of at least 'length' bytes */
+static unsigned int find_vma_gap(struct vma *vma, unsigned int length)
 {
 	unsigned int addr;
-	struct vma *vma;
 
-	if(!length) {
+	if(!vma || vma->max_gap < length) {
 		return 0;
 	}
-
-	addr = MMAP_START;
-	vma = current->vma_table;
-
-	while(vma) {
-		if(vma->start < MMAP_START) {
-			vma = vma->next;
-			continue;
+	if(vma->start > MMAP_START) {
+		if((addr = find_vma_gap(vma->left, length))) {
+			return addr;
 		}
-		if(vma->start - addr >= length) {
-			return PAGE_ALIGN(addr);
+	}
+	if(vma->start >= MMAP_START) {
+		addr = vma == current->mm->vma_table ? 0 : PAGE_ALIGN(vma->prev->end);
+		addr = MAX(addr, MMAP_START);
+		if(vma->start >= addr && vma->start - addr >= length) {
+			return addr;
 		}
-		addr = PAGE_ALIGN(vma->end);
-		vma = vma->next;
 	}
-	return 0;
+	return find_vma_gap(vma->right, length);
+}
+
+/* return the first free address that matches with the size of length */
+unsigned int get_unmapped_vma_region(unsigned int length)
+{
+	if(!length) {
+		return 0;
+	}
+
+	return find_vma_gap(current->mm->vma_tree, length);
 }
 
 int do_mmap(struct inode *i, unsigned int start, unsigned int length, unsigned int prot, unsigned int flags, unsigned int offset, char type, char mode, void *object)
@@ -492,7 +1051,7 @@ int do_mmap(struct inode *i, unsigned int start, unsigned int length, unsigned i
 		}
 	}
 
-	if(!(vma = (struct vma *)kmalloc(sizeof(struct vma)))) {
+	if(!(vma = (struct vma *)slab_alloc(vma_cache))) {
                 return -ENOMEM;
         }
         memset_b(vma, 0, sizeof(struct vma));
@@ -511,7 +1070,7 @@ int do_mmap(struct inode *i, unsigned int start, unsigned int length, unsigned i
 	if(i && i->fsop->mmap) {
 		if((errno = i->fsop->mmap(i, vma))) {
 			free_vma_region(vma, start, length);
-			kfree((unsigned int)vma);
+			slab_free(vma_cache, vma);
 			return errno;
 		}
 	}
@@ -542,19 +1101,66 @@ int do_munmap(unsigned int addr, __size_t length)
 			free_vma_pages(vma, addr, size);
 			invalidate_tlb();
 			free_vma_region(vma, addr, size);
-			length -= size;
-			addr += size;
+		} else {
+			/* skip the holes */
+			size = PAGE_SIZE;
 		}
+		length -= size;
+		addr += size;
 	}
 
 	return 0;
 }
 
+/*
+ * Removes the write permission of the pages already mapped in a private
+ * region. They are marked as copy-on-write, so they can become writable
+ * again on the next write fault if the region recovers its PROT_WRITE.
+ */
+static int write_protect_pages(unsigned int start, unsigned int end)
+{
+	unsigned int *pgdir, *pgtbl;
+	unsigned int n, pde, pte;
+	struct page *pg;
+
+	pgdir = (unsigned int *)P2V(current->tss.cr3);
+	for(n = start; n < end; n += PAGE_SIZE) {
+		pde = GET_PGDIR(n);
+		pte = GET_PGTBL(n);
+		if(!(pgdir[pde] & PAGE_PRESENT)) {
+			continue;
+		}
+		/*
+		 * A page table shared after a fork() still keeps the writable
+		 * entries, which would become usable once the other processes
+		 * leave it. Split it now to write-protect them.
+		 */
+		if(unshare_page_table(current, n)) {
+			return -ENOMEM;
+		}
+		pgtbl = (unsigned int *)P2V((pgdir[pde] & PAGE_MASK));
+		if(!(pgtbl[pte] & PAGE_PRESENT) || !(pgtbl[pte] & PAGE_RW)) {
+			continue;
+		}
+		if(pgtbl[pte] & PAGE_NOALLOC) {
+			continue;
+		}
+		pg = &page_table[pgtbl[pte] >> PAGE_SHIFT];
+		if(pg->flags & PAGE_RESERVED) {
+			continue;
+		}
+		pg->flags |= PAGE_COW;
+		pgtbl[pte] &= ~PAGE_RW;
+		invalidate_tlb_page(n);
+	}
+	return 0;
+}
+
 int do_mprotect(struct vma *vma, unsigned int addr, __size_t length, int prot)
 {
 	struct vma *new;
 
-	if(!(new = (struct vma *)kmalloc(sizeof(struct vma)))) {
+	if(!(new = (struct vma *)slab_alloc(vma_cache))) {
                 return -ENOMEM;
         }
         memset_b(new, 0, sizeof(struct vma));
@@ -566,7 +1172,191 @@ int do_mprotect(struct vma *vma, unsigned int addr, __size_t length, int prot)
 	new->s_type = vma->s_type;
 	new->inode = vma->inode;
 	new->o_mode = vma->o_mode;
+	new->advice = vma->advice;
+	if(!(prot & PROT_WRITE) && !(vma->flags & MAP_SHARED) && !vma->object) {
+		if(write_protect_pages(addr, addr + length)) {
+			slab_free(vma_cache, new);
+			return -ENOMEM;
+		}
+	}
 	add_vma_region(new);
 
 	return 0;
 }
+
+/* splits a vma region in two at 'addr', leaving its pages untouched */
+static int split_vma_region(struct vma *vma, unsigned int addr)
+{
+	unsigned int flags;
+	struct vma *new;
+
+	if(!(new = (struct vma *)slab_alloc(vma_cache))) {
+		return -ENOMEM;
+	}
+	*new = *vma;
+	new->start = addr;
+	if(vma->inode) {
+		new->offset += addr - vma->start;
+		vma->inode->count++;
+	}
+
+	SAVE_FLAGS(flags); CLI();
+	vma->end = addr;
+	link_vma_region(new);
+	RESTORE_FLAGS(flags);
+	return 0;
+}
+
+int do_madvise(unsigned int addr, __size_t length, int advice)
+{
+	struct vma *vma;
+	unsigned int end, size, offset;
+
+	end = addr + length;
+	while(addr < end) {
+		if(!(vma = find_vma_region(addr))) {
+			return -ENOMEM;
+		}
+		size = MIN(vma->end, end) - addr;
+
+		switch(advice) {
+			case MADV_WILLNEED:
+				if(vma->inode && S_ISREG(vma->inode->i_mode)) {
+					offset = addr - vma->start + vma->offset;
+					page_readahead(vma->inode, offset, size / PAGE_SIZE);
+				}
+				break;
+			case MADV_DONTNEED:
+				/* the next access will find them zero-filled or re-read */
+				if(!vma->object) {
+					free_vma_pages(vma, addr, size);
+					invalidate_tlb();
+				}
+				break;
+			default:
+				/* shared memory segments are attached as a whole */
+				if(vma->object || vma->advice == advice) {
+					break;
+				}
+				if(addr > vma->start) {
+					if(split_vma_region(vma, addr)) {
+						return -ENOMEM;
+					}
+					vma = vma->next;
+				}
+				if(end < vma->end) {
+					if(split_vma_region(vma, end)) {
+						return -ENOMEM;
+					}
+				}
+				vma->advice = advice;
+				break;
+		}
+		addr += size;
+	}
+	return 0;
+}
+
+int do_mremap(unsigned int addr, __size_t old_length, __size_t new_length, int flags, unsigned int new_addr)
+{
+	struct vma *vma, *new;
+
+	if(!(vma = find_vma_region(addr)) || addr + old_length > vma->end) {
+		return -EFAULT;
+	}
+
+	/* shared memory segments are attached as a whole */
+	if(vma->object) {
+		return -EINVAL;
+	}
+
+	if(!(flags & MREMAP_FIXED)) {
+		if(new_length <= old_length) {
+			if(new_length < old_length) {
+				do_munmap(addr + new_length, old_length - new_length);
+			}
+			return addr;
+		}
+
+		/* try to expand the region in place */
+		if(addr + old_length == vma->end && addr + new_length > addr && addr + new_length <= PAGE_OFFSET) {
+			if(!find_vma_intersection(vma->end, addr + new_length)) {
+				vma->end = addr + new_length;
+				update_vma_region(vma);
+				return addr;
+			}
+		}
+		if(!(flags & MREMAP_MAYMOVE)) {
+			return -ENOMEM;
+		}
+	}
+
+	if(flags & MREMAP_FIXED) {
+		do_munmap(new_addr, new_length);
+		/* the region might have been split */
+		vma = find_vma_region(addr);
+	} else if(!(new_addr = get_unmapped_vma_region(new_length))) {
+		return -ENOMEM;
+	}
+
+	if(!(new = (struct vma *)slab_alloc(vma_cache))) {
+		return -ENOMEM;
+	}
+	*new = *vma;
+	new->start = new_addr;
+	new->end = new_addr + new_length;
+	if(vma->inode) {
+		new->offset += addr - vma->start;
+	}
+
+	/* the pages are moved instead of copied */
+	if(move_page_range(addr, new_addr, MIN(old_length, new_length))) {
+		slab_free(vma_cache, new);
+		return -ENOMEM;
+	}
+	if(new->inode) {
+		new->inode->count++;
+	}
+	add_vma_region(new);
+	do_munmap(addr, old_length);
+	return new_addr;
+}
+
+int do_msync(unsigned int addr, __size_t length, int flags)
+{
+	struct vma *vma;
+	__dev_t devs[NR_MOUNT_POINTS];
+	unsigned int end, size;
+	int n, ndevs, errno, retval;
+
+	retval = ndevs = 0;
+	end = addr + length;
+	while(addr < end) {
+		if(!(vma = find_vma_region(addr))) {
+			retval = -ENOMEM;
+			break;
+		}
+		size = MIN(vma->end, end) - addr;
+		if((errno = writeback_vma_pages(vma, addr, addr + size)) < 0) {
+			retval = errno;
+		}
+		/* each device is synced only once, after all the writebacks */
+		if(flags & MS_SYNC && vma->inode && vma->flags & MAP_SHARED) {
+			for(n = 0; n < ndevs; n++) {
+				if(devs[n] == vma->inode->dev) {
+					break;
+				}
+			}
+			if(n == ndevs && ndevs < NR_MOUNT_POINTS) {
+				devs[ndevs++] = vma->inode->dev;
+			}
+		}
+		addr += size;
+	}
+
+	for(n = 0; n < ndevs; n++) {
+		sync_inodes(devs[n]);
+		sync_buffers(devs[n]);
+	}
+	return retval;
+}
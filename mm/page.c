@@ -20,6 +20,18 @@
  * +--------+  +--------------+  +--------------+  +--------------+
  *              (page)            (page)            (page)  
  *    ...
+ *
+ * Free pages that still hold file contents are kept on two LRU lists
+ * instead of the free list. A cached page is released to the active list
+ * if it was referenced while in use (found in the hash or accessed through
+ * a PTE), and to the inactive list otherwise. New pages are taken from the
+ * free list first and then from the head of the inactive list, which is
+ * refilled with the oldest active pages when it becomes too small. Thus a
+ * large sequential read only recycles inactive pages.
+ *
+ * The contents of regular files are kept only here, not in the buffer
+ * cache. Their blocks are read straight into the pages, and a written block
+ * gets a buffer that points into its page until kbdflushd flushes it.
  */
 
 #include <fiwix/asm.h>
@@ -29,8 +41,10 @@
 #include <fiwix/bios.h>
 #include <fiwix/sleep.h>
 #include <fiwix/sched.h>
+#include <fiwix/process.h>
 #include <fiwix/devices.h>
 #include <fiwix/buffer.h>
+#include <fiwix/fcntl.h>
 #include <fiwix/errno.h>
 #include <fiwix/stdio.h>
 #include <fiwix/string.h>
@@ -42,6 +56,9 @@
 
 struct page *page_table;		/* page pool */
 struct page *page_head;			/* page pool head */
+static struct page *active_head;	/* free cached pages recently used */
+static struct page *inactive_head;	/* free cached pages to be reused */
+static struct page *zeroed_head;	/* free pages already zero-filled */
 struct page **page_hash_table;
 
 static void insert_to_hash(struct page *pg)
@@ -94,16 +111,48 @@ static void remove_from_hash(struct page *pg)
 	}
 }
 
-static void insert_on_free_list(struct page *pg)
+static void insert_on_list(struct page **head, struct page *pg)
 {
-	if(!page_head) {
+	if(!*head) {
 		pg->prev_free = pg->next_free = pg;
-		page_head = pg;
+		*head = pg;
 	} else {
-		pg->next_free = page_head;
-		pg->prev_free = page_head->prev_free;
-		page_head->prev_free->next_free = pg;
-		page_head->prev_free = pg;
+		pg->next_free = *head;
+		pg->prev_free = (*head)->prev_free;
+		(*head)->prev_free->next_free = pg;
+		(*head)->prev_free = pg;
+	}
+}
+
+static void remove_from_list(struct page **head, struct page *pg)
+{
+	pg->prev_free->next_free = pg->next_free;
+	pg->next_free->prev_free = pg->prev_free;
+	if(pg == *head) {
+		*head = pg->next_free;
+		if(pg == *head) {
+			*head = NULL;
+		}
+	}
+}
+
+static void insert_on_free_list(struct page *pg)
+{
+	if(pg->flags & PAGE_ZEROED) {
+		insert_on_list(&zeroed_head, pg);
+		kstat.zeroed_pages++;
+	} else if(!pg->inode) {
+		insert_on_list(&page_head, pg);
+	} else if(pg->flags & PAGE_REFERENCED) {
+		pg->flags &= ~PAGE_REFERENCED;
+		pg->flags |= PAGE_ACTIVE;
+		insert_on_list(&active_head, pg);
+		kstat.active_pages++;
+		kstat.pgactivate++;
+	} else {
+		pg->flags |= PAGE_INACTIVE;
+		insert_on_list(&inactive_head, pg);
+		kstat.inactive_pages++;
 	}
 
 	kstat.free_pages++;
@@ -115,15 +164,35 @@ static void remove_from_free_list(struct page *pg)
 		return;
 	}
 
-	pg->prev_free->next_free = pg->next_free;
-	pg->next_free->prev_free = pg->prev_free;
-	kstat.free_pages--;
-	if(pg == page_head) {
-		page_head = pg->next_free;
+	if(pg->flags & PAGE_ACTIVE) {
+		remove_from_list(&active_head, pg);
+		kstat.active_pages--;
+	} else if(pg->flags & PAGE_INACTIVE) {
+		remove_from_list(&inactive_head, pg);
+		kstat.inactive_pages--;
+	} else if(pg->flags & PAGE_ZEROED) {
+		remove_from_list(&zeroed_head, pg);
+		kstat.zeroed_pages--;
+	} else {
+		remove_from_list(&page_head, pg);
 	}
+	pg->flags &= ~(PAGE_ACTIVE | PAGE_INACTIVE | PAGE_ZEROED);
+	kstat.free_pages--;
+}
 
-	if(!kstat.free_pages) {
-		page_head = NULL;
+/* move the oldest active pages to the tail of the inactive list */
+static void refill_inactive_list(void)
+{
+	struct page *pg;
+
+	while((pg = active_head) && (!inactive_head || kstat.inactive_pages * 2 < kstat.active_pages)) {
+		remove_from_list(&active_head, pg);
+		kstat.active_pages--;
+		pg->flags &= ~PAGE_ACTIVE;
+		pg->flags |= PAGE_INACTIVE;
+		insert_on_list(&inactive_head, pg);
+		kstat.inactive_pages++;
+		kstat.pgdeactivate++;
 	}
 }
 
@@ -154,7 +223,12 @@ void page_unlock(struct page *pg)
 	RESTORE_FLAGS(flags);
 }
 
-struct page *get_free_page(void)
+/*
+ * Takes a page from the uncached free pages, then from the pre-zeroed pool
+ * and finally from the inactive list. If 'zeroed' is set the pre-zeroed
+ * pool is tried first. The pages from that pool keep the PAGE_ZEROED flag.
+ */
+static struct page *take_free_page(int zeroed)
 {
 	unsigned int flags;
 	struct page *pg;
@@ -168,7 +242,7 @@ struct page *get_free_page(void)
 
 			if(!kstat.free_pages && !kstat.pages_reclaimed) {
 				/* definitely out of memory! (no more pages) */
-				printk("WARNING: %s(): out of memory and swapping is not implemented yet, sorry.\n", __FUNCTION__);
+				printk("WARNING: %s(): out of memory and no more pages can be reclaimed.\n", __FUNCTION__);
 				printk("%s(): pid %d ran out of memory. OOM killer needed!\n", __FUNCTION__, current->pid);
 				return NULL;
 			}
@@ -187,14 +261,23 @@ struct page *get_free_page(void)
 
 	SAVE_FLAGS(flags); CLI();
 
-	if(!(pg = page_head)) {
-		printk("WARNING: page_head returned NULL! (free_pages = %d)\n", kstat.free_pages);
-		RESTORE_FLAGS(flags);
-		return NULL;
+	if(!zeroed || !(pg = zeroed_head)) {
+		if(!(pg = page_head) && !(pg = zeroed_head)) {
+			/* no uncached pages left, reuse the oldest inactive one */
+			refill_inactive_list();
+			if(!(pg = inactive_head)) {
+				printk("WARNING: page_head returned NULL! (free_pages = %d)\n", kstat.free_pages);
+				RESTORE_FLAGS(flags);
+				return NULL;
+			}
+			kstat.pgcache_evictions++;
+		}
 	}
 
+	zeroed = pg->flags & PAGE_ZEROED;
 	remove_from_free_list(pg);
 	remove_from_hash(pg);	/* remove it from its old hash */
+	pg->flags |= zeroed;
 	pg->count = 1;
 	pg->inode = 0;
 	pg->offset = 0;
@@ -204,7 +287,121 @@ struct page *get_free_page(void)
 	return pg;
 }
 
-struct page *search_page_hash(struct inode *inode, __off_t offset)
+struct page *get_free_page(void)
+{
+	struct page *pg;
+
+	if((pg = take_free_page(0))) {
+		pg->flags &= ~PAGE_ZEROED;
+	}
+	return pg;
+}
+
+/* returns a zero-filled page, from the pre-zeroed pool if possible */
+struct page *get_zeroed_page(void)
+{
+	struct page *pg;
+
+	if(!(pg = take_free_page(1))) {
+		return NULL;
+	}
+	if(pg->flags & PAGE_ZEROED) {
+		pg->flags &= ~PAGE_ZEROED;
+		kstat.pgzero_pool++;
+	} else {
+		clear_page(pg->data);
+		kstat.pgzero_sync++;
+	}
+	return pg;
+}
+
+/*
+ * Called from cpu_idle() to fill the pool of pre-zeroed pages up to
+ * NR_ZEROED_PAGES. It stops as soon as there is something else to run.
+ * Returns the number of pages zeroed.
+ */
+int zero_free_pages(void)
+{
+	unsigned int flags;
+	struct page *pg;
+	int zeroed;
+
+	zeroed = 0;
+	while(!need_resched && kstat.zeroed_pages < NR_ZEROED_PAGES) {
+		SAVE_FLAGS(flags); CLI();
+		if(!(pg = page_head) || kstat.free_pages <= kstat.min_free_pages) {
+			RESTORE_FLAGS(flags);
+			break;
+		}
+		/* keep it busy while it's cleared with interrupts enabled */
+		remove_from_free_list(pg);
+		pg->count = 1;
+		RESTORE_FLAGS(flags);
+
+		clear_page(pg->data);
+
+		SAVE_FLAGS(flags); CLI();
+		pg->count = 0;
+		pg->flags |= PAGE_ZEROED;
+		insert_on_free_list(pg);
+		RESTORE_FLAGS(flags);
+		zeroed++;
+	}
+	return zeroed;
+}
+
+/*
+ * Returns the first page of a range of 'npages' free pages that are
+ * physically contiguous and naturally aligned to 'npages' (which must be
+ * a power of two). Cached pages in the range are dropped from the cache.
+ */
+struct page *get_contig_pages(int npages)
+{
+	unsigned int flags;
+	struct page *pg;
+	int n, i;
+
+	if(kstat.free_pages < npages) {
+		wakeup(&kswapd);
+		return NULL;
+	}
+
+	SAVE_FLAGS(flags); CLI();
+
+	for(n = 0; n + npages <= NR_PAGES; n += npages) {
+		for(i = 0; i < npages; i++) {
+			pg = &page_table[n + i];
+			if(pg->count || pg->flags & (PAGE_RESERVED | PAGE_LOCKED | PAGE_BUDDYHIGH)) {
+				break;
+			}
+		}
+		if(i == npages) {
+			break;
+		}
+	}
+	if(n + npages > NR_PAGES) {
+		RESTORE_FLAGS(flags);
+		return NULL;
+	}
+
+	for(i = 0; i < npages; i++) {
+		pg = &page_table[n + i];
+		if(pg->inode) {
+			kstat.pgcache_evictions++;
+		}
+		remove_from_free_list(pg);
+		remove_from_hash(pg);
+		pg->count = 1;
+		pg->inode = 0;
+		pg->offset = 0;
+		pg->dev = 0;
+	}
+
+	RESTORE_FLAGS(flags);
+	return &page_table[n];
+}
+
+static struct page *lookup_page_hash(struct inode *inode, __off_t offset)
 {
 	struct page *pg;
 	int i;
@@ -214,18 +411,53 @@ struct page *search_page_hash(struct inode *inode, __off_t offset)
 
 	while(pg) {
 		if(pg->inode == inode->inode && pg->offset == offset && pg->dev == inode->dev) {
-			if(!pg->count) {
-				remove_from_free_list(pg);
-			}
-			pg->count++;
 			return pg;
 		}
 		pg = pg->next_hash;
 	}
-
 	return NULL;
 }
 
+struct page *search_page_hash(struct inode *inode, __off_t offset)
+{
+	unsigned int flags;
+	struct page *pg;
+
+	/* the page might be released by a readahead completion interrupt */
+	SAVE_FLAGS(flags); CLI();
+	if((pg = lookup_page_hash(inode, offset))) {
+		if(!pg->count) {
+			remove_from_free_list(pg);
+		}
+		pg->count++;
+		pg->flags |= PAGE_REFERENCED;
+		kstat.pgcache_hits++;
+	} else {
+		kstat.pgcache_misses++;
+	}
+	RESTORE_FLAGS(flags);
+	return pg;
+}
+
+/* gets a cached page only if its contents are valid, it never starts I/O */
+struct page *get_cached_page(struct inode *inode, __off_t offset)
+{
+	unsigned int flags;
+	struct page *pg;
+
+	SAVE_FLAGS(flags); CLI();
+	if((pg = lookup_page_hash(inode, offset)) && !(pg->flags & PAGE_LOCKED)) {
+		if(!pg->count) {
+			remove_from_free_list(pg);
+		}
+		pg->count++;
+	} else {
+		pg = NULL;
+	}
+	RESTORE_FLAGS(flags);
+	return pg;
+}
+
 void release_page(struct page *pg)
 {
 	unsigned int flags;
@@ -234,22 +466,24 @@ void release_page(struct page *pg)
 		PANIC("Unexpected inconsistency in hash_table. Missing page %d (0x%x).\n", pg->page, pg->page);
 	}
 
+	SAVE_FLAGS(flags); CLI();
+
 	if(!pg->count) {
+		RESTORE_FLAGS(flags);
 		printk("WARNING: %s(): trying to free an already freed page (%d)!\n", __FUNCTION__, pg->page);
 		return;
 	}
 
 	if(--pg->count > 0) {
+		RESTORE_FLAGS(flags);
 		return;
 	}
 
-	SAVE_FLAGS(flags); CLI();
+	/* remove all flags except PAGE_RESERVED and PAGE_REFERENCED */
+	pg->flags &= PAGE_RESERVED | PAGE_REFERENCED;
 
 	insert_on_free_list(pg);
 
-	/* remove all flags except PAGE_RESERVED */
-	pg->flags &= PAGE_RESERVED;
-
 	/* if page is not cached then place it at the head of the free list */
 	if(!pg->inode) {
 		page_head = pg;
@@ -281,32 +515,144 @@ void invalidate_inode_pages(struct inode *i)
 	for(offset = 0; offset < i->i_size; offset += PAGE_SIZE) {
 		if((pg = search_page_hash(i, offset))) {
 			page_lock(pg);
-			release_page(pg);
+			remove_from_hash(pg);
+			pg->inode = 0;
+			pg->offset = 0;
+			pg->dev = 0;
 			page_unlock(pg);
+			release_page(pg);
+		}
+	}
+}
+
+/* drops the cached pages of a file range that are not in use */
+void drop_inode_pages(struct inode *i, __off_t offset, __off_t end)
+{
+	unsigned int flags;
+	struct page *pg;
+
+	for(; offset < end; offset += PAGE_SIZE) {
+		SAVE_FLAGS(flags); CLI();
+		if((pg = lookup_page_hash(i, offset))) {
+			if(!pg->count && !(pg->flags & PAGE_LOCKED)) {
+				remove_from_free_list(pg);
+				remove_from_hash(pg);
+				pg->flags &= ~PAGE_REFERENCED;
+				pg->inode = 0;
+				pg->offset = 0;
+				pg->dev = 0;
+				insert_on_free_list(pg);
+			}
+		}
+		RESTORE_FLAGS(flags);
+	}
+}
+
+/*
+ * Harvests the accessed bits of the PTEs that map cached pages, so these
+ * pages will go to the active list once they are unmapped.
+ */
+void age_page_cache(void)
+{
+	struct proc *p;
+	struct page *pg;
+	unsigned int *pgdir, *pgtbl;
+	unsigned int pde, pte;
+
+	FOR_EACH_PROCESS(p) {
+		if(p->flags & PF_KPROC || p->state == PROC_ZOMBIE || !p->mm->vma_table) {
+			p = p->next;
+			continue;
+		}
+		pgdir = (unsigned int *)P2V(p->tss.cr3);
+		for(pde = 0; pde < GET_PGDIR(PAGE_OFFSET); pde++) {
+			if(!(pgdir[pde] & PAGE_PRESENT)) {
+				continue;
+			}
+			pgtbl = (unsigned int *)P2V((pgdir[pde] & PAGE_MASK));
+			for(pte = 0; pte < PT_ENTRIES; pte++) {
+				if((pgtbl[pte] & (PAGE_PRESENT | PAGE_ACCESSED | PAGE_NOALLOC)) != (PAGE_PRESENT | PAGE_ACCESSED)) {
+					continue;
+				}
+				pg = &page_table[pgtbl[pte] >> PAGE_SHIFT];
+				if(pg->inode && !(pg->flags & PAGE_RESERVED)) {
+					pgtbl[pte] &= ~PAGE_ACCESSED;
+					pg->flags |= PAGE_REFERENCED;
+				}
+			}
+		}
+		p = p->next;
+	}
+}
+
+/*
+ * Drops the cached pages of a file beyond its new size 'length', and zeroes
+ * the contents of the ones kept that were beyond the old or the new size.
+ */
+void truncate_inode_pages(struct inode *i, __off_t length)
+{
+	struct page *pg;
+	__off_t from, offset;
+	int poffset;
+
+	/* only the pages from the new size up to the old one are affected */
+	from = MIN(i->i_size, length);
+	for(offset = from & PAGE_MASK; offset < i->i_size; offset += PAGE_SIZE) {
+		if(!(pg = search_page_hash(i, offset))) {
+			continue;
+		}
+		page_lock(pg);
+		if(pg->offset >= length) {
 			remove_from_hash(pg);
+			pg->inode = 0;
+			pg->offset = 0;
+			pg->dev = 0;
+		} else {
+			poffset = pg->offset < from ? from - pg->offset : 0;
+			memset_b(pg->data + poffset, 0, PAGE_SIZE - poffset);
 		}
+		page_unlock(pg);
+		release_page(pg);
 	}
 }
 
-void update_page_cache(struct inode *i, __off_t offset, const char *buf, int count)
+/*
+ * Writes 'count' bytes of the file block 'block' into its cached page, that
+ * is the only place where file data is kept. The buffer of the block just
+ * points into the page, until kbdflushd writes it to the disk.
+ */
+int write_page_block(struct inode *i, __off_t offset, __blk_t block, const char *buf, int count)
 {
-	__off_t poffset;
+	unsigned int addr;
 	struct page *pg;
-	int bytes;
+	int blksize, poffset, errno;
 
+	blksize = i->sb->s_blocksize;
 	poffset = offset % PAGE_SIZE;
-	offset &= PAGE_MASK;
-	bytes = PAGE_SIZE - poffset;
-
-	if(count) {
-		bytes = MIN(bytes, count);
-		if((pg = search_page_hash(i, offset))) {
-			page_lock(pg);
-			memcpy_b(pg->data + poffset, buf, bytes);
-			page_unlock(pg);
-			release_page(pg);
+	if(!(pg = search_page_hash(i, offset & PAGE_MASK))) {
+		if(!(addr = kmalloc(PAGE_SIZE))) {
+			return -ENOMEM;
 		}
+		pg = &page_table[V2P(addr) >> PAGE_SHIFT];
+		if(bread_page(pg, i, offset & PAGE_MASK, 0, MAP_SHARED)) {
+			kfree(addr);
+			return -EIO;
+		}
+	}
+
+	/* wait for a pending readahead */
+	page_lock(pg);
+	if(pg->flags & PAGE_IOERROR) {
+		page_unlock(pg);
+		release_page(pg);
+		return -EIO;
 	}
+	page_unlock(pg);
+
+	memcpy_b(pg->data + poffset, buf, count);
+	errno = bwrite_page(pg, pg->data + (poffset & ~(blksize - 1)), i->dev, block, blksize);
+	release_page(pg);
+	return errno;
 }
 
 int write_page(struct page *pg, struct inode *i, __off_t offset, unsigned int length)
@@ -347,9 +693,13 @@ int bread_page(struct page *pg, struct inode *i, __off_t offset, char prot, char
 	}
 
 	memset_b(&brh, 0, sizeof(struct blk_request));
+	brh.flags = BRF_PAGE;
 	page_lock(pg);
 
-	/* cache any read-only or public (shared) pages */
+	/*
+	 * Cache any read-only or public (shared) pages. The private writable
+	 * mappings also read them read-only and make a copy on the first write.
+	 */
 	if(!(prot & PROT_WRITE) || flags & MAP_SHARED) {
 		pg->inode = i->inode;
 		pg->offset = offset;
@@ -358,7 +708,7 @@ int bread_page(struct page *pg, struct inode *i, __off_t offset, char prot, char
 	}
 
 	while(size_read < PAGE_SIZE) {
-		if(!(br = (struct blk_request *)kmalloc(sizeof(struct blk_request)))) {
+		if(!(br = (struct blk_request *)slab_alloc(blk_request_cache))) {
 			printk("WARNING: %s(): no more free memory for block requests.\n", __FUNCTION__);
 			retval = 1;
 			break;
@@ -374,6 +724,7 @@ int bread_page(struct page *pg, struct inode *i, __off_t offset, char prot, char
 		br->size = blksize;
 		br->device = d;
 		br->fn = d->fsop->read_block;
+		br->data = pg->data + size_read;
 		br->head_group = &brh;
 		if(!brh.next_group) {
 			brh.next_group = br;
@@ -393,23 +744,17 @@ int bread_page(struct page *pg, struct inode *i, __off_t offset, char prot, char
 	 */
 	retval = retval < 0 ? retval : 0;
 	br = brh.next_group;
-	size_read = 0;
 	while(br) {
-		if(!retval) {
-			if(br->block) {
-				memcpy_b(pg->data + size_read, br->buffer->data, br->size);
-				br->buffer->flags |= BUFFER_VALID;
-			} else {
-				/* fill the hole with zeros */
-				memset_b(pg->data + size_read, 0, br->size);
-			}
-			size_read += br->size;
+		/* the blocks were read straight into the page */
+		if(!retval && !br->block) {
+			/* fill the hole with zeros */
+			memset_b(br->data, 0, br->size);
 		}
-		if(br->block) {
+		if(br->buffer) {
 			brelse(br->buffer);
 		}
 		tmp = br->next_group;
-		kfree((unsigned int)br);
+		slab_free(blk_request_cache, br);
 		br = tmp;
 	}
 
@@ -417,6 +762,186 @@ int bread_page(struct page *pg, struct inode *i, __off_t offset, char prot, char
 	return retval;
 }
 
+/* completes a page read ahead, it might run in interrupt context */
+static void end_readahead(struct blk_request *brh)
+{
+	struct blk_request *br, *tmp;
+	struct page *pg;
+	int error;
+
+	pg = (struct page *)brh->data;
+	error = 0;
+	br = brh->next_group;
+	while(br) {
+		if(br->errno < 0) {
+			error = 1;
+		} else if(!br->block) {
+			/* fill the hole with zeros */
+			memset_b(br->data, 0, br->size);
+		}
+		if(br->buffer) {
+			brelse(br->buffer);
+		}
+		tmp = br->next_group;
+		slab_free(blk_request_cache, br);
+		br = tmp;
+	}
+	slab_free(blk_request_cache, brh);
+
+	if(error) {
+		remove_from_hash(pg);
+		pg->inode = 0;
+		pg->flags |= PAGE_IOERROR;
+	}
+	page_unlock(pg);
+	release_page(pg);
+}
+
+/* starts reading a page into the cache without waiting for it */
+static int readahead_page(struct inode *i, __off_t offset, struct device *d)
+{
+	struct blk_request *brh, *br, *tmp;
+	struct page *pg;
+	unsigned int addr, flags;
+	__blk_t block;
+	__off_t size_read;
+
+	if(lookup_page_hash(i, offset)) {
+		return 0;
+	}
+	/* don't take the pages needed by the demand reads */
+	if(kstat.free_pages <= kstat.min_free_pages) {
+		return 1;
+	}
+	if(!(brh = (struct blk_request *)slab_alloc(blk_request_cache))) {
+		return 1;
+	}
+	if(!(addr = kmalloc(PAGE_SIZE))) {
+		slab_free(blk_request_cache, brh);
+		return 1;
+	}
+	pg = &page_table[V2P(addr) >> PAGE_SHIFT];
+	memset_b(brh, 0, sizeof(struct blk_request));
+	brh->flags = BRF_PAGE;
+	brh->end_io = end_readahead;
+	brh->data = pg;
+
+	/* the allocations might have slept while another process cached it */
+	SAVE_FLAGS(flags); CLI();
+	if(lookup_page_hash(i, offset)) {
+		RESTORE_FLAGS(flags);
+		slab_free(blk_request_cache, brh);
+		kfree(addr);
+		return 0;
+	}
+	page_lock(pg);
+	pg->inode = i->inode;
+	pg->offset = offset;
+	pg->dev = i->dev;
+	insert_to_hash(pg);
+	RESTORE_FLAGS(flags);
+
+	tmp = NULL;
+	for(size_read = 0; size_read < PAGE_SIZE; size_read += i->sb->s_blocksize) {
+		if((block = bmap(i, offset + size_read, FOR_READING)) < 0) {
+			break;
+		}
+		if(!(br = (struct blk_request *)slab_alloc(blk_request_cache))) {
+			break;
+		}
+		memset_b(br, 0, sizeof(struct blk_request));
+		br->dev = i->dev;
+		br->block = block;
+		br->flags = block ? 0 : BRF_NOBLOCK;
+		br->size = i->sb->s_blocksize;
+		br->device = d;
+		br->fn = d->fsop->read_block;
+		br->data = pg->data + size_read;
+		br->head_group = brh;
+		if(!brh->next_group) {
+			brh->next_group = br;
+		} else {
+			tmp->next_group = br;
+		}
+		tmp = br;
+	}
+
+	if(size_read < PAGE_SIZE) {
+		br = brh->next_group;
+		while(br) {
+			tmp = br->next_group;
+			slab_free(blk_request_cache, br);
+			br = tmp;
+		}
+		slab_free(blk_request_cache, brh);
+		remove_from_hash(pg);
+		pg->inode = 0;
+		page_unlock(pg);
+		kfree(addr);
+		return 1;
+	}
+
+	kstat.pgreadahead++;
+	gbread_async(d, brh);
+	return 0;
+}
+
+/* reads ahead up to 'pages' pages of the file starting at 'offset' */
+void page_readahead(struct inode *i, __off_t offset, int pages)
+{
+	struct device *d;
+
+	if(!(d = get_device(BLK_DEV, i->dev))) {
+		return;
+	}
+	while(pages-- > 0 && offset < i->i_size) {
+		if(readahead_page(i, offset, d)) {
+			break;
+		}
+		offset += PAGE_SIZE;
+	}
+}
+
+/*
+ * Sequential reads double the readahead window up to READAHEAD_MAX pages,
+ * starting a new readahead when half of the previous one has been used.
+ * A random read halves the window.
+ */
+static void file_readahead(struct inode *i, struct fd *fd_table, __off_t offset)
+{
+	__off_t start, end;
+
+	if(fd_table->advice == POSIX_FADV_RANDOM) {
+		return;
+	}
+	if(offset == fd_table->ra_next - PAGE_SIZE) {
+		return;		/* same page again */
+	}
+	if(offset != fd_table->ra_next) {
+		if(fd_table->advice != POSIX_FADV_SEQUENTIAL) {
+			fd_table->ra_pages >>= 1;
+		}
+		fd_table->ra_next = fd_table->ra_end = offset + PAGE_SIZE;
+		return;
+	}
+	fd_table->ra_next = offset + PAGE_SIZE;
+	if(offset + ((fd_table->ra_pages / 2) * PAGE_SIZE) < fd_table->ra_end) {
+		return;
+	}
+
+	if(fd_table->advice == POSIX_FADV_SEQUENTIAL) {
+		fd_table->ra_pages = READAHEAD_MAX;
+	} else {
+		fd_table->ra_pages = fd_table->ra_pages ? MIN(fd_table->ra_pages * 2, READAHEAD_MAX) : READAHEAD_MIN;
+	}
+	start = MAX(offset + PAGE_SIZE, fd_table->ra_end);
+	end = offset + ((fd_table->ra_pages + 1) * PAGE_SIZE);
+	if(start < end) {
+		page_readahead(i, start, (end - start) / PAGE_SIZE);
+		fd_table->ra_end = end;
+	}
+}
+
 int file_read(struct inode *i, struct fd *fd_table, char *buffer, __size_t count)
 {
 	__size_t total_read;
@@ -454,14 +979,25 @@ int file_read(struct inode *i, struct fd *fd_table, char *buffer, __size_t count
 		} else {
 			addr = (unsigned int)pg->data;
 		}
+		file_readahead(i, fd_table, fd_table->offset & PAGE_MASK);
 
 		page_lock(pg);
+		if(pg->flags & PAGE_IOERROR) {
+			page_unlock(pg);
+			kfree(addr);
+			inode_unlock(i);
+			return -EIO;
+		}
 		bytes = PAGE_SIZE - poffset;
 		bytes = MIN(bytes, count);
 		memcpy_b(buffer + total_read, pg->data + poffset, bytes);
 		total_read += bytes;
 		count -= bytes;
 		fd_table->offset += bytes;
+		/* pages read only once go to the inactive list */
+		if(fd_table->advice == POSIX_FADV_SEQUENTIAL || fd_table->advice == POSIX_FADV_NOREUSE) {
+			pg->flags &= ~PAGE_REFERENCED;
+		}
 		kfree(addr);
 		page_unlock(pg);
 	}
@@ -0,0 +1,195 @@
+/*
+ * fiwix/mm/slab.c
+ *
+ * Copyright 2018-2022, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+/*
+ * slab.c implements object caches for fixed-size kernel structures.
+ *
+ * Each slab is a single page with a 'struct slab' header at its start,
+ * followed by as many objects as fit in the rest of the page. The free
+ * objects of a slab are chained through their first word, so the optional
+ * constructor of a cache is called every time an object is allocated.
+ *
+ *  slab_cache
+ * +----------+    +------+-----+-----+-----+ ... +-----+
+ * | partial -+--> | slab | obj | obj | obj | ... | obj |  (page)
+ * | full     |    +------+-----+-----+-----+ ... +-----+
+ * | empty    |
+ * +----------+
+ */
+
+#include <fiwix/asm.h>
+#include <fiwix/kernel.h>
+#include <fiwix/mm.h>
+#include <fiwix/stdio.h>
+#include <fiwix/string.h>
+
+struct slab_cache slab_cache_table[NR_SLAB_CACHES];
+
+static void insert_slab(struct slab **h, struct slab *s)
+{
+	s->prev = NULL;
+	s->next = *h;
+	if(*h) {
+		(*h)->prev = s;
+	}
+	*h = s;
+}
+
+static void remove_slab(struct slab **h, struct slab *s)
+{
+	if(s->next) {
+		s->next->prev = s->prev;
+	}
+	if(s->prev) {
+		s->prev->next = s->next;
+	}
+	if(s == *h) {
+		*h = s->next;
+	}
+	s->prev = s->next = NULL;
+}
+
+static struct slab *new_slab(struct slab_cache *sc)
+{
+	struct slab *s;
+	struct page *pg;
+	unsigned int addr;
+	char *obj;
+	int n;
+
+	if(!(addr = kmalloc(PAGE_SIZE))) {
+		return NULL;
+	}
+	pg = &page_table[V2P(addr) >> PAGE_SHIFT];
+	pg->flags |= PAGE_SLAB;
+
+	s = (struct slab *)addr;
+	s->cache = sc;
+	s->inuse = 0;
+	s->free = NULL;
+	obj = (char *)addr + SLAB_HDR_SIZE;
+	for(n = 0; n < sc->objs_per_slab; n++) {
+		*(void **)obj = s->free;
+		s->free = obj;
+		obj += sc->size;
+	}
+	return s;
+}
+
+static void destroy_slab(struct slab_cache *sc, struct slab *s)
+{
+	struct page *pg;
+	unsigned int addr;
+
+	addr = (unsigned int)s;
+	pg = &page_table[V2P(addr) >> PAGE_SHIFT];
+	pg->flags &= ~PAGE_SLAB;
+	sc->num_slabs--;
+	kfree(addr);
+}
+
+struct slab_cache *slab_cache_create(const char *name, int size, void (*ctor)(void *))
+{
+	struct slab_cache *sc;
+	int n;
+
+	/* objects must be able to hold the free list pointer */
+	size = MAX(size, sizeof(void *));
+	size = (size + (sizeof(void *) - 1)) & ~(sizeof(void *) - 1);
+	if(size > PAGE_SIZE - SLAB_HDR_SIZE) {
+		printk("WARNING: %s(): object size (%d) of '%s' is too big.\n", __FUNCTION__, size, name);
+		return NULL;
+	}
+
+	for(n = 0; n < NR_SLAB_CACHES; n++) {
+		sc = &slab_cache_table[n];
+		if(!sc->name) {
+			memset_b(sc, 0, sizeof(struct slab_cache));
+			sc->name = name;
+			sc->size = size;
+			sc->objs_per_slab = (PAGE_SIZE - SLAB_HDR_SIZE) / size;
+			sc->ctor = ctor;
+			return sc;
+		}
+	}
+
+	printk("WARNING: %s(): no more slab caches for '%s'.\n", __FUNCTION__, name);
+	return NULL;
+}
+
+void *slab_alloc(struct slab_cache *sc)
+{
+	unsigned int flags;
+	struct slab *s;
+	void *obj;
+
+	SAVE_FLAGS(flags); CLI();
+	if(!(s = sc->partial)) {
+		if((s = sc->empty)) {
+			remove_slab(&sc->empty, s);
+		} else {
+			/* getting a new page might sleep */
+			RESTORE_FLAGS(flags);
+			if(!(s = new_slab(sc))) {
+				return NULL;
+			}
+			SAVE_FLAGS(flags); CLI();
+			sc->num_slabs++;
+		}
+		insert_slab(&sc->partial, s);
+	}
+
+	obj = s->free;
+	s->free = *(void **)obj;
+	s->inuse++;
+	if(!s->free) {
+		remove_slab(&sc->partial, s);
+		insert_slab(&sc->full, s);
+	}
+	sc->active_objs++;
+	sc->allocs++;
+	RESTORE_FLAGS(flags);
+
+	if(sc->ctor) {
+		sc->ctor(obj);
+	}
+	return obj;
+}
+
+void slab_free(struct slab_cache *sc, void *obj)
+{
+	unsigned int flags;
+	struct slab *s;
+
+	s = (struct slab *)((unsigned int)obj & PAGE_MASK);
+	if(s->cache != sc) {
+		printk("WARNING: %s(): object 0x%x doesn't belong to cache '%s'.\n", __FUNCTION__, (unsigned int)obj, sc->name);
+		return;
+	}
+
+	SAVE_FLAGS(flags); CLI();
+	if(!s->free) {
+		remove_slab(&sc->full, s);
+		insert_slab(&sc->partial, s);
+	}
+	*(void **)obj = s->free;
+	s->free = obj;
+	s->inuse--;
+	sc->active_objs--;
+	sc->frees++;
+
+	if(!s->inuse) {
+		remove_slab(&sc->partial, s);
+		/* keep only one empty slab per cache */
+		if(!sc->empty) {
+			insert_slab(&sc->empty, s);
+		} else {
+			destroy_slab(sc, s);
+		}
+	}
+	RESTORE_FLAGS(flags);
+}
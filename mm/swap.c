@@ -0,0 +1,582 @@
+/*
+ * fiwix/mm/swap.c
+ *
+ * Copyright 2024, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+/*
+ * swap.c moves anonymous pages of user processes out to swap areas (block
+ * devices or regular files prepared with mkswap) when kswapd is unable to
+ * reclaim enough memory from the caches.
+ *
+ * Each swap area has a map with the number of page table entries that
+ * refer to each of its slots. The victim pages are chosen with the clock
+ * algorithm: a hand walks through the address space of every process,
+ * giving a second chance to the pages recently accessed.
+ */
+
+#include <fiwix/asm.h>
+#include <fiwix/kernel.h>
+#include <fiwix/mm.h>
+#include <fiwix/mman.h>
+#include <fiwix/fs.h>
+#include <fiwix/stat.h>
+#include <fiwix/buffer.h>
+#include <fiwix/blk_queue.h>
+#include <fiwix/process.h>
+#include <fiwix/sched.h>
+#include <fiwix/sleep.h>
+#include <fiwix/swap.h>
+#include <fiwix/errno.h>
+#include <fiwix/stdio.h>
+#include <fiwix/string.h>
+
+struct swap_area swap_table[NR_SWAP_AREAS];
+
+/* clock hand */
+static __pid_t swap_pid;
+static unsigned int swap_addr;
+
+/*
+ * The pages are transferred using a request from the stack, since kswapd
+ * can't wait for memory to be freed while it's trying to free memory.
+ */
+static int swap_rw(int mode, unsigned int entry, char *data)
+{
+	unsigned int flags;
+	struct swap_area *sa;
+	struct buffer buf;
+	struct blk_request br;
+	int n, blocks;
+
+	sa = &swap_table[SWP_TYPE(entry)];
+	blocks = PAGE_SIZE / sa->blksize;
+
+	for(n = 0; n < blocks; n++) {
+		memset_b(&buf, 0, sizeof(struct buffer));
+		buf.dev = sa->dev;
+		if(sa->blocks) {
+			buf.block = sa->blocks[(SWP_OFFSET(entry) * blocks) + n];
+		} else {
+			buf.block = (SWP_OFFSET(entry) * blocks) + n;
+		}
+		buf.size = sa->blksize;
+		buf.data = data + (n * sa->blksize);
+
+		memset_b(&br, 0, sizeof(struct blk_request));
+		br.dev = buf.dev;
+		br.block = buf.block;
+		br.size = buf.size;
+		br.buffer = &buf;
+		br.device = sa->device;
+		br.fn = mode == BLK_READ ? sa->device->fsop->read_block : sa->device->fsop->write_block;
+
+		add_blk_request(&br);
+		run_blk_request(sa->device);
+		SAVE_FLAGS(flags); CLI();
+		if(br.status != BR_COMPLETED) {
+			sleep(&br, PROC_UNINTERRUPTIBLE);
+		}
+		RESTORE_FLAGS(flags);
+		if(br.errno < 0) {
+			printk("WARNING: %s(): I/O error on slot %d of device %d,%d.\n", __FUNCTION__, SWP_OFFSET(entry), MAJOR(sa->dev), MINOR(sa->dev));
+			return br.errno;
+		}
+	}
+	return 0;
+}
+
+static unsigned int *get_pte(struct proc *p, unsigned int addr)
+{
+	unsigned int *pgdir, *pgtbl;
+	unsigned int pde;
+
+	pgdir = (unsigned int *)P2V(p->tss.cr3);
+	pde = GET_PGDIR(addr);
+	if(!(pgdir[pde] & PAGE_PRESENT)) {
+		return NULL;
+	}
+	pgtbl = (unsigned int *)P2V((pgdir[pde] & PAGE_MASK));
+	return &pgtbl[GET_PGTBL(addr)];
+}
+
+static int is_swappable_proc(struct proc *p)
+{
+	if(p->flags & PF_KPROC || p->state == PROC_ZOMBIE || p->pid == IDLE) {
+		return 0;
+	}
+	return p->mm->vma_table != NULL;
+}
+
+int is_swapped(struct proc *p, unsigned int addr)
+{
+	unsigned int *pte;
+
+	if(!(pte = get_pte(p, addr))) {
+		return 0;
+	}
+	return IS_SWP_ENTRY(*pte);
+}
+
+unsigned int get_swap_page(void)
+{
+	unsigned int flags;
+	struct swap_area *sa;
+	unsigned int n, offset;
+	int type;
+
+	SAVE_FLAGS(flags); CLI();
+	for(type = 0; type < NR_SWAP_AREAS; type++) {
+		sa = &swap_table[type];
+		if(!(sa->flags & SWP_WRITEOK)) {
+			continue;
+		}
+		for(n = 0; n < sa->pages; n++) {
+			offset = (sa->next + n) % sa->pages;
+			if(!sa->map[offset]) {
+				sa->map[offset] = 1;
+				sa->next = offset + 1;
+				kstat.free_swap_pages--;
+				RESTORE_FLAGS(flags);
+				return SWP_ENTRY(type, offset);
+			}
+		}
+	}
+	RESTORE_FLAGS(flags);
+	return 0;
+}
+
+void swap_duplicate(unsigned int entry)
+{
+	struct swap_area *sa;
+	unsigned int offset;
+
+	sa = &swap_table[SWP_TYPE(entry)];
+	offset = SWP_OFFSET(entry);
+	if(!(sa->flags & SWP_USED) || offset >= sa->pages) {
+		printk("WARNING: %s(): invalid swap entry 0x%08x.\n", __FUNCTION__, entry);
+		return;
+	}
+	if(sa->map[offset] < SWAP_MAP_MAX) {
+		sa->map[offset]++;
+	}
+}
+
+void swap_free(unsigned int entry)
+{
+	unsigned int flags;
+	struct swap_area *sa;
+	unsigned int offset;
+
+	sa = &swap_table[SWP_TYPE(entry)];
+	offset = SWP_OFFSET(entry);
+	if(!(sa->flags & SWP_USED) || offset >= sa->pages) {
+		printk("WARNING: %s(): invalid swap entry 0x%08x.\n", __FUNCTION__, entry);
+		return;
+	}
+
+	SAVE_FLAGS(flags); CLI();
+	if(!sa->map[offset]) {
+		printk("WARNING: %s(): trying to free an already freed slot (%d).\n", __FUNCTION__, offset);
+	} else if(sa->map[offset] < SWAP_MAP_MAX) {
+		if(!--sa->map[offset]) {
+			kstat.free_swap_pages++;
+		}
+	}
+	RESTORE_FLAGS(flags);
+}
+
+/* brings back a page of the current process from the swap area */
+int swap_in(struct vma *vma, unsigned int cr2)
+{
+	unsigned int *pte;
+	unsigned int entry, addr;
+
+	if(unshare_page_table(current, cr2)) {
+		return 1;
+	}
+	pte = get_pte(current, cr2);
+	entry = *pte;
+
+	if(!(addr = kmalloc(PAGE_SIZE))) {
+		return 1;
+	}
+	if(swap_rw(BLK_READ, entry, (char *)addr) < 0) {
+		kfree(addr);
+		return 1;
+	}
+
+	/* another thread could have brought it back while sleeping */
+	pte = get_pte(current, cr2);
+	if(!pte || *pte != entry) {
+		kfree(addr);
+		return 0;
+	}
+	*pte = V2P(addr) | PAGE_PRESENT | PAGE_USER;
+	if(vma->prot & PROT_WRITE) {
+		*pte |= PAGE_RW;
+	}
+	current->mm->rss++;
+	current->usage.ru_majflt++;
+	kstat.pswpin++;
+	swap_free(entry);
+	invalidate_tlb();
+	return 0;
+}
+
+/*
+ * The page is written while it's still mapped and then it's replaced by
+ * its swap entry only if the process has not modified it in the meantime.
+ */
+static int swap_out_page(struct proc *p, unsigned int addr)
+{
+	unsigned int *pte;
+	unsigned int entry, paddr;
+	struct page *pg;
+	__pid_t pid;
+	int errno;
+
+	if(!(entry = get_swap_page())) {
+		return -ENOSPC;
+	}
+
+	pid = p->pid;
+	pte = get_pte(p, addr);
+	paddr = *pte & PAGE_MASK;
+	*pte &= ~PAGE_DIRTY;
+	pg = &page_table[paddr >> PAGE_SHIFT];
+	pg->count++;
+
+	errno = swap_rw(BLK_WRITE, entry, pg->data);
+
+	/* the process could have exited while sleeping */
+	if(!errno && (p = get_proc_by_pid(pid)) && is_swappable_proc(p)) {
+		pte = get_pte(p, addr);
+		if(pte && (*pte & (PAGE_MASK | PAGE_PRESENT | PAGE_DIRTY)) == (paddr | PAGE_PRESENT) && pg->count == 2) {
+			*pte = entry;
+			p->mm->rss--;
+			p->usage.ru_nswap++;
+			kstat.pswpout++;
+			release_page(pg);
+			release_page(pg);
+			return 1;
+		}
+	}
+
+	swap_free(entry);
+	release_page(pg);
+	return errno;
+}
+
+/* advances the clock hand through the address space of the process */
+static int swap_out_proc(struct proc *p, int *scanned)
+{
+	struct vma *vma;
+	struct page *pg;
+	unsigned int *pte;
+	unsigned int addr;
+
+	for(vma = p->mm->vma_table; vma; vma = vma->next) {
+		if(vma->end <= swap_addr || vma->flags & MAP_SHARED || vma->object) {
+			continue;
+		}
+		for(addr = MAX(vma->start, swap_addr); addr < vma->end; addr += PAGE_SIZE) {
+			(*scanned)++;
+			if(!(pte = get_pte(p, addr))) {
+				continue;
+			}
+			if(!(*pte & PAGE_PRESENT) || *pte & PAGE_NOALLOC) {
+				continue;
+			}
+			/* second chance */
+			if(*pte & PAGE_ACCESSED) {
+				*pte &= ~PAGE_ACCESSED;
+				continue;
+			}
+			pg = &page_table[*pte >> PAGE_SHIFT];
+			if(pg->count != 1 || pg->inode || pg->flags & (PAGE_RESERVED | PAGE_LOCKED)) {
+				continue;
+			}
+			swap_addr = addr + PAGE_SIZE;
+			return swap_out_page(p, addr);
+		}
+	}
+
+	swap_pid = p->pid + 1;
+	swap_addr = 0;
+	return 0;
+}
+
+static struct proc *get_swap_proc(void)
+{
+	struct proc *p, *next;
+	int wrap;
+
+	for(wrap = 0; wrap < 2; wrap++) {
+		next = NULL;
+		FOR_EACH_PROCESS(p) {
+			if(is_swappable_proc(p) && p->pid >= swap_pid) {
+				if(!next || p->pid < next->pid) {
+					next = p;
+				}
+			}
+			p = p->next;
+		}
+		if(next) {
+			if(next->pid != swap_pid) {
+				swap_pid = next->pid;
+				swap_addr = 0;
+			}
+			return next;
+		}
+		swap_pid = 0;
+	}
+	return NULL;
+}
+
+/* swaps out up to 'nr_pages' pages, called from kswapd */
+int swap_out(int nr_pages)
+{
+	struct proc *p;
+	int swapped, scanned, n;
+
+	swapped = scanned = 0;
+
+	/* two turns of the clock hand at most */
+	while(kstat.free_swap_pages && swapped < nr_pages && scanned < (kstat.total_mem_pages * 2)) {
+		if(!(p = get_swap_proc())) {
+			break;
+		}
+		if((n = swap_out_proc(p, &scanned)) < 0) {
+			break;
+		}
+		swapped += n;
+	}
+	return swapped;
+}
+
+/* brings back all the pages from the swap area 'type' */
+static int try_to_unuse(int type)
+{
+	struct proc *p;
+	struct vma *vma;
+	unsigned int *pte;
+	unsigned int addr, entry, vaddr;
+	unsigned int *pgdir, *pgtbl;
+	unsigned int pde, n;
+	__pid_t pid;
+
+	for(;;) {
+		entry = vaddr = 0;
+		FOR_EACH_PROCESS(p) {
+			if(!is_swappable_proc(p)) {
+				p = p->next;
+				continue;
+			}
+			pgdir = (unsigned int *)P2V(p->tss.cr3);
+			for(pde = 0; pde < GET_PGDIR(PAGE_OFFSET) && !entry; pde++) {
+				if(!(pgdir[pde] & PAGE_PRESENT)) {
+					continue;
+				}
+				pgtbl = (unsigned int *)P2V((pgdir[pde] & PAGE_MASK));
+				for(n = 0; n < PT_ENTRIES; n++) {
+					if(IS_SWP_ENTRY(pgtbl[n]) && SWP_TYPE(pgtbl[n]) == type) {
+						entry = pgtbl[n];
+						vaddr = (pde << 22) | (n << PAGE_SHIFT);
+						break;
+					}
+				}
+			}
+			if(entry) {
+				break;
+			}
+			p = p->next;
+		}
+		if(!entry) {
+			return 0;
+		}
+
+		pid = p->pid;
+		if(!(addr = kmalloc(PAGE_SIZE))) {
+			return -ENOMEM;
+		}
+		if(swap_rw(BLK_READ, entry, (char *)addr) < 0) {
+			kfree(addr);
+			return -EIO;
+		}
+		if((p = get_proc_by_pid(pid)) && (pte = get_pte(p, vaddr)) && *pte == entry) {
+			*pte = V2P(addr) | PAGE_PRESENT | PAGE_USER;
+			if((vma = find_proc_vma_region(p, vaddr)) && vma->prot & PROT_WRITE) {
+				*pte |= PAGE_RW;
+			}
+			p->mm->rss++;
+			swap_free(entry);
+		} else {
+			kfree(addr);
+		}
+	}
+}
+
+int do_swapon(struct inode *i)
+{
+	struct swap_area *sa;
+	struct swap_header *hdr;
+	unsigned int pages, n, bad;
+	int type, errno;
+
+	for(type = 0; type < NR_SWAP_AREAS; type++) {
+		sa = &swap_table[type];
+		if(sa->flags & SWP_USED && sa->inode == i) {
+			return -EBUSY;
+		}
+	}
+	for(type = 0; type < NR_SWAP_AREAS; type++) {
+		sa = &swap_table[type];
+		if(!sa->flags) {
+			break;
+		}
+	}
+	if(type == NR_SWAP_AREAS) {
+		return -EPERM;
+	}
+	memset_b(sa, 0, sizeof(struct swap_area));
+
+	if(S_ISBLK(i->i_mode)) {
+		sa->dev = i->rdev;
+		if(!(sa->device = get_device(BLK_DEV, sa->dev))) {
+			return -ENXIO;
+		}
+		if(!i->fsop || !i->fsop->open) {
+			return -ENXIO;
+		}
+		if((errno = i->fsop->open(i, NULL))) {
+			return errno;
+		}
+		sa->blksize = BLKSIZE_1K;
+		pages = ((unsigned int *)sa->device->device_data)[MINOR(sa->dev)] / (PAGE_SIZE / 1024);
+	} else if(S_ISREG(i->i_mode)) {
+		sa->dev = i->dev;
+		if(!(sa->device = get_device(BLK_DEV, sa->dev))) {
+			return -ENXIO;
+		}
+		sa->blksize = i->sb->s_blocksize;
+		pages = i->i_size / PAGE_SIZE;
+		n = pages * (PAGE_SIZE / sa->blksize);
+		if(!pages || !(sa->blocks = (__blk_t *)kmalloc(n * sizeof(__blk_t)))) {
+			return -ENOMEM;
+		}
+		/* swap files can't have holes */
+		while(n--) {
+			if((sa->blocks[n] = bmap(i, n * sa->blksize, FOR_READING)) <= 0) {
+				kfree((unsigned int)sa->blocks);
+				return -EINVAL;
+			}
+		}
+	} else {
+		return -EINVAL;
+	}
+	if(!sa->device->fsop || !sa->device->fsop->read_block || !sa->device->fsop->write_block) {
+		errno = -EINVAL;
+		goto err;
+	}
+
+	/* the header is in the first slot */
+	sa->flags = SWP_USED;
+	if(!(hdr = (struct swap_header *)kmalloc(PAGE_SIZE))) {
+		errno = -ENOMEM;
+		goto err;
+	}
+	if((errno = swap_rw(BLK_READ, SWP_ENTRY(type, 0), (char *)hdr)) < 0) {
+		kfree((unsigned int)hdr);
+		goto err;
+	}
+	if(strncmp((char *)hdr + PAGE_SIZE - SWAP_SIGNATURE_LEN, SWAP_SIGNATURE, SWAP_SIGNATURE_LEN) || hdr->version != 1) {
+		printk("WARNING: %s(): unable to find a swap signature.\n", __FUNCTION__);
+		kfree((unsigned int)hdr);
+		errno = -EINVAL;
+		goto err;
+	}
+	sa->pages = MIN(pages, hdr->last_page + 1);
+	if(sa->pages < 2 || !(sa->map = (unsigned char *)kmalloc(sa->pages))) {
+		kfree((unsigned int)hdr);
+		errno = sa->pages < 2 ? -EINVAL : -ENOMEM;
+		goto err;
+	}
+	memset_b(sa->map, 0, sa->pages);
+	sa->map[0] = SWAP_MAP_BAD;
+	bad = 1;
+	for(n = 0; n < hdr->nr_badpages && n < (PAGE_SIZE - sizeof(struct swap_header)) / sizeof(unsigned int); n++) {
+		if(hdr->badpages[n] && hdr->badpages[n] < sa->pages) {
+			sa->map[hdr->badpages[n]] = SWAP_MAP_BAD;
+			bad++;
+		}
+	}
+	kfree((unsigned int)hdr);
+
+	sa->inode = i;
+	sa->next = 1;
+	sa->flags = SWP_USED | SWP_WRITEOK;
+	kstat.swap_pages += sa->pages - bad;
+	kstat.free_swap_pages += sa->pages - bad;
+	printk("swap: activated %dKB on device %d,%d.\n", (sa->pages - bad) << 2, MAJOR(sa->dev), MINOR(sa->dev));
+	return 0;
+
+err:
+	if(sa->blocks) {
+		kfree((unsigned int)sa->blocks);
+	}
+	if(S_ISBLK(i->i_mode) && i->fsop->close) {
+		i->fsop->close(i, NULL);
+	}
+	sa->flags = 0;
+	return errno;
+}
+
+int do_swapoff(struct inode *i)
+{
+	struct swap_area *sa;
+	unsigned int n, bad, used;
+	int type, errno;
+
+	for(type = 0; type < NR_SWAP_AREAS; type++) {
+		sa = &swap_table[type];
+		if(sa->flags & SWP_USED && sa->inode == i) {
+			break;
+		}
+	}
+	if(type == NR_SWAP_AREAS) {
+		return -EINVAL;
+	}
+
+	for(n = 0, bad = 0, used = 0; n < sa->pages; n++) {
+		if(sa->map[n] == SWAP_MAP_BAD) {
+			bad++;
+		} else if(sa->map[n]) {
+			used++;
+		}
+	}
+	/* all the pages must fit back into memory */
+	if(used > kstat.free_pages) {
+		return -ENOMEM;
+	}
+
+	sa->flags &= ~SWP_WRITEOK;
+	if((errno = try_to_unuse(type))) {
+		sa->flags |= SWP_WRITEOK;
+		return errno;
+	}
+
+	kstat.swap_pages -= sa->pages - bad;
+	kstat.free_swap_pages -= sa->pages - bad;
+	kfree((unsigned int)sa->map);
+	if(sa->blocks) {
+		kfree((unsigned int)sa->blocks);
+	}
+	if(S_ISBLK(i->i_mode) && i->fsop->close) {
+		i->fsop->close(i, NULL);
+	}
+	iput(sa->inode);
+	memset_b(sa, 0, sizeof(struct swap_area));
+	return 0;
+}
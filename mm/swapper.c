@@ -20,6 +20,7 @@
 #include <fiwix/mm.h>
 #include <fiwix/fs.h>
 #include <fiwix/filesystems.h>
+#include <fiwix/swap.h>
 #include <fiwix/stdio.h>
 
 /* kswapd continues the kernel initialization */
@@ -48,7 +49,12 @@ int kswapd(void)
 
 	for(;;) {
 		sleep(&kswapd, PROC_INTERRUPTIBLE);
-		if((kstat.pages_reclaimed = reclaim_buffers())) {
+		age_page_cache();
+		kstat.pages_reclaimed = buddy_high_reclaim();
+		if((kstat.pages_reclaimed += reclaim_buffers())) {
+			continue;
+		}
+		if((kstat.pages_reclaimed += swap_out(NR_SWAP_RECLAIM))) {
 			continue;
 		}
 		wakeup(&get_free_page);